@@ -0,0 +1,154 @@
+// Benchmark lepton-jet cleaning: vectorized dR^2 kernel vs scalar deltaR
+//
+// Created by Samvel Khalatyan, Feb 22, 2012
+// Copyright 2012, All rights reserved
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "DataFormats/Math/interface/deltaR.h"
+
+#include "bsm_input_maker/maker/interface/Selector.h"
+
+using namespace std;
+using namespace boost;
+
+typedef vector<float> Floats;
+
+static float uniform(const float &min, const float &max)
+{
+    return min + (max - min) * (static_cast<float>(rand()) / RAND_MAX);
+}
+
+static void generate(Floats &eta, Floats &phi, const size_t &size)
+{
+    eta.resize(size);
+    phi.resize(size);
+
+    for(size_t i = 0; size > i; ++i)
+    {
+        eta[i] = uniform(-2.5, 2.5);
+        phi[i] = uniform(-M_PI, M_PI);
+    }
+}
+
+// Current implementation: loop over jets and call deltaR per lepton
+//
+static size_t scalar(const Floats &jet_eta, const Floats &jet_phi,
+        const Floats &lepton_eta, const Floats &lepton_phi,
+        const double &cone)
+{
+    size_t matches = 0;
+    for(size_t jet = 0, jets = jet_eta.size(); jets > jet; ++jet)
+    {
+        for(size_t lepton = 0, leptons = lepton_eta.size();
+                leptons > lepton;
+                ++lepton)
+        {
+            if (cone >= reco::deltaR(lepton_eta[lepton], lepton_phi[lepton],
+                        jet_eta[jet], jet_phi[jet]))
+                ++matches;
+        }
+    }
+
+    return matches;
+}
+
+// New implementation: dR^2 kernel over all jets per lepton
+//
+static size_t kernel(const Floats &jet_eta, const Floats &jet_phi,
+        const Floats &lepton_eta, const Floats &lepton_phi,
+        const float &cone2, Floats &dr2)
+{
+    const size_t jets = jet_eta.size();
+    dr2.resize(jets);
+
+    size_t matches = 0;
+    for(size_t lepton = 0, leptons = lepton_eta.size();
+            leptons > lepton;
+            ++lepton)
+    {
+        bsm::selector::deltaR2(lepton_eta[lepton], lepton_phi[lepton],
+                &jet_eta[0], &jet_phi[0], jets, &dr2[0]);
+
+        for(size_t jet = 0; jets > jet; ++jet)
+        {
+            if (cone2 >= dr2[jet])
+                ++matches;
+        }
+    }
+
+    return matches;
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace posix_time;
+
+    const size_t events = 1 < argc ? lexical_cast<size_t>(argv[1]) : 100000;
+    const size_t leptons = 2 < argc ? lexical_cast<size_t>(argv[2]) : 2;
+    const double cone = 0.5;
+
+    cout << "events: " << events << " leptons: " << leptons
+        << " cone: " << cone << endl;
+    cout << setw(6) << "jets"
+        << setw(14) << "scalar, ns"
+        << setw(14) << "kernel, ns"
+        << setw(10) << "speedup"
+        << endl;
+
+    const size_t sizes[] = {4, 8, 16, 32, 64, 128, 256};
+
+    Floats jet_eta;
+    Floats jet_phi;
+    Floats lepton_eta;
+    Floats lepton_phi;
+    Floats dr2;
+
+    for(size_t size = 0; sizeof(sizes) / sizeof(sizes[0]) > size; ++size)
+    {
+        srand(size);
+        generate(jet_eta, jet_phi, sizes[size]);
+        generate(lepton_eta, lepton_phi, leptons);
+
+        size_t scalar_matches = 0;
+        ptime start = microsec_clock::universal_time();
+        for(size_t event = 0; events > event; ++event)
+            scalar_matches += scalar(jet_eta, jet_phi,
+                    lepton_eta, lepton_phi, cone);
+
+        const double scalar_time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        size_t kernel_matches = 0;
+        start = microsec_clock::universal_time();
+        for(size_t event = 0; events > event; ++event)
+            kernel_matches += kernel(jet_eta, jet_phi,
+                    lepton_eta, lepton_phi, cone * cone, dr2);
+
+        const double kernel_time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        cout << setw(6) << sizes[size]
+            << setw(14) << 1e3 * scalar_time / events
+            << setw(14) << 1e3 * kernel_time / events
+            << setw(10) << (kernel_time ? scalar_time / kernel_time : 0)
+            << endl;
+
+        if (scalar_matches != kernel_matches)
+        {
+            cerr << "matches mismatch: scalar " << scalar_matches
+                << " kernel " << kernel_matches << endl;
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
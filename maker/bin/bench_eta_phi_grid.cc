@@ -0,0 +1,203 @@
+// Benchmark dR search: brute force and dR^2 kernel vs eta-phi grid
+//
+// Created by Samvel Khalatyan, Mar 13, 2012
+// Copyright 2012, All rights reserved
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include "DataFormats/Math/interface/deltaR.h"
+
+#include "bsm_input_maker/maker/interface/EtaPhiGrid.h"
+#include "bsm_input_maker/maker/interface/Selector.h"
+
+using namespace std;
+using namespace boost;
+
+typedef vector<float> Floats;
+
+static float uniform(const float &min, const float &max)
+{
+    return min + (max - min) * (static_cast<float>(rand()) / RAND_MAX);
+}
+
+static void generate(Floats &eta, Floats &phi, const size_t &size)
+{
+    eta.resize(size);
+    phi.resize(size);
+
+    for(size_t i = 0; size > i; ++i)
+    {
+        eta[i] = uniform(-2.5, 2.5);
+        phi[i] = uniform(-M_PI, M_PI);
+    }
+}
+
+// All pairs with reco::deltaR
+//
+static size_t brute(const Floats &eta, const Floats &phi,
+        const Floats &query_eta, const Floats &query_phi,
+        const double &cone)
+{
+    size_t matches = 0;
+    for(size_t query = 0, queries = query_eta.size(); queries > query; ++query)
+    {
+        for(size_t object = 0, objects = eta.size(); objects > object; ++object)
+        {
+            if (cone >= reco::deltaR(query_eta[query], query_phi[query],
+                        eta[object], phi[object]))
+                ++matches;
+        }
+    }
+
+    return matches;
+}
+
+// All pairs with vectorized dR^2 kernel
+//
+static size_t kernel(const Floats &eta, const Floats &phi,
+        const Floats &query_eta, const Floats &query_phi,
+        const float &cone2, Floats &dr2)
+{
+    const size_t objects = eta.size();
+    dr2.resize(objects);
+
+    size_t matches = 0;
+    for(size_t query = 0, queries = query_eta.size(); queries > query; ++query)
+    {
+        bsm::selector::deltaR2(query_eta[query], query_phi[query],
+                &eta[0], &phi[0], objects, &dr2[0]);
+
+        for(size_t object = 0; objects > object; ++object)
+        {
+            if (cone2 >= dr2[object])
+                ++matches;
+        }
+    }
+
+    return matches;
+}
+
+// Grid is built per event, as in production
+//
+static size_t grid(const Floats &eta, const Floats &phi,
+        const Floats &query_eta, const Floats &query_phi,
+        bsm::EtaPhiGrid &index, bsm::EtaPhiGrid::Indices &found)
+{
+    index.clear();
+    for(size_t object = 0, objects = eta.size(); objects > object; ++object)
+        index.add(object, eta[object], phi[object]);
+
+    index.build();
+
+    size_t matches = 0;
+    for(size_t query = 0, queries = query_eta.size(); queries > query; ++query)
+    {
+        index.find(query_eta[query], query_phi[query], found);
+
+        matches += found.size();
+    }
+
+    return matches;
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace posix_time;
+
+    const size_t events = 1 < argc ? lexical_cast<size_t>(argv[1]) : 20000;
+    const size_t queries = 2 < argc ? lexical_cast<size_t>(argv[2]) : 2;
+    const double cone = 3 < argc ? lexical_cast<double>(argv[3]) : 0.5;
+
+    cout << "events: " << events << " queries: " << queries
+        << " cone: " << cone << endl;
+    cout << setw(8) << "objects"
+        << setw(12) << "brute, ns"
+        << setw(12) << "kernel, ns"
+        << setw(12) << "grid, ns"
+        << endl;
+
+    const size_t sizes[] = {2, 4, 8, 16, 32, 64, 128, 256, 512, 1024};
+
+    Floats eta;
+    Floats phi;
+    Floats query_eta;
+    Floats query_phi;
+    Floats dr2;
+
+    // Inclusive cone as in the jet cleaning kernel
+    //
+    bsm::EtaPhiGrid index(cone, true);
+    bsm::EtaPhiGrid::Indices found;
+
+    size_t brute_crossover = 0;
+    size_t kernel_crossover = 0;
+    for(size_t size = 0; sizeof(sizes) / sizeof(sizes[0]) > size; ++size)
+    {
+        srand(size);
+        generate(eta, phi, sizes[size]);
+        generate(query_eta, query_phi, queries);
+
+        size_t brute_matches = 0;
+        ptime start = microsec_clock::universal_time();
+        for(size_t event = 0; events > event; ++event)
+            brute_matches += brute(eta, phi, query_eta, query_phi, cone);
+
+        const double brute_time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        size_t kernel_matches = 0;
+        start = microsec_clock::universal_time();
+        for(size_t event = 0; events > event; ++event)
+            kernel_matches += kernel(eta, phi, query_eta, query_phi,
+                    cone * cone, dr2);
+
+        const double kernel_time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        size_t grid_matches = 0;
+        start = microsec_clock::universal_time();
+        for(size_t event = 0; events > event; ++event)
+            grid_matches += grid(eta, phi, query_eta, query_phi,
+                    index, found);
+
+        const double grid_time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        cout << setw(8) << sizes[size]
+            << setw(12) << 1e3 * brute_time / events
+            << setw(12) << 1e3 * kernel_time / events
+            << setw(12) << 1e3 * grid_time / events
+            << endl;
+
+        if (brute_matches != kernel_matches
+                || brute_matches != grid_matches)
+        {
+            cerr << "matches mismatch: brute " << brute_matches
+                << " kernel " << kernel_matches
+                << " grid " << grid_matches << endl;
+
+            return 1;
+        }
+
+        if (!brute_crossover
+                && grid_time < brute_time)
+            brute_crossover = sizes[size];
+
+        if (!kernel_crossover
+                && grid_time < kernel_time)
+            kernel_crossover = sizes[size];
+    }
+
+    cout << "grid is faster than brute force from " << brute_crossover
+        << " objects, than kernel from " << kernel_crossover
+        << " objects (0 - never)" << endl;
+
+    return 0;
+}
@@ -0,0 +1,268 @@
+// Benchmark event construction: new message per event vs recycled message
+//
+// Created by Samvel Khalatyan, Mar 15, 2012
+// Copyright 2012, All rights reserved
+
+#include <stdint.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "bsm_input_maker/bsm_input/interface/Event.pb.h"
+#include "bsm_input_maker/bsm_input/interface/Physics.pb.h"
+#include "bsm_input_maker/bsm_input/interface/Trigger.pb.h"
+#include "bsm_input_maker/maker/interface/EventRecycler.h"
+#include "bsm_input_maker/maker/interface/ExtraFields.h"
+#include "bsm_input_maker/maker/interface/Utility.h"
+
+using namespace std;
+using namespace boost;
+
+// Count all heap allocations of the process
+//
+static uint64_t allocations = 0;
+
+void *operator new(size_t size) throw(bad_alloc)
+{
+    ++allocations;
+
+    void *memory = malloc(size ? size : 1);
+    if (!memory)
+        throw bad_alloc();
+
+    return memory;
+}
+
+void operator delete(void *memory) throw()
+{
+    free(memory);
+}
+
+void *operator new[](size_t size) throw(bad_alloc)
+{
+    return operator new(size);
+}
+
+void operator delete[](void *memory) throw()
+{
+    operator delete(memory);
+}
+
+struct Sizes
+{
+    int leptons;
+    int jets;
+    int trigger_objects;
+    int filters;
+    int gen_particles;
+};
+
+static void p4(bsm::LorentzVector *p4)
+{
+    p4->set_e(rand() % 1000);
+    p4->set_px(rand() % 100);
+    p4->set_py(rand() % 100);
+    p4->set_pz(rand() % 100);
+}
+
+static void genParticle(bsm::GenParticle *particle, const int &level)
+{
+    particle->set_id(rand() % 25);
+    particle->set_status(3);
+    p4(particle->mutable_physics_object()->mutable_p4());
+
+    if (!level)
+        return;
+
+    for(int child = 0; 2 > child; ++child)
+        genParticle(particle->add_child(), level - 1);
+}
+
+// Packed keys of the compact filters: length-delimited extra field
+//
+static const string packed_keys(12, '\x01');
+
+// Event content in the proportions of the production events. Recycled
+// event stores length-delimited extra fields via recycler
+//
+static void build(bsm::Event &event,
+        const Sizes &sizes,
+        bsm::EventRecycler *recycler = 0)
+{
+    bsm::utility::addVarint(&event, bsm::extra_field::EVENT_CHANNELS, 1);
+
+    for(int lepton = 0; sizes.leptons > lepton; ++lepton)
+    {
+        p4(event.add_electron()->mutable_physics_object()->mutable_p4());
+        p4(event.add_muon()->mutable_physics_object()->mutable_p4());
+    }
+
+    for(int jet = 0; sizes.jets > jet; ++jet)
+    {
+        bsm::Jet *pb_jet = event.add_jet();
+        p4(pb_jet->mutable_physics_object()->mutable_p4());
+
+        for(int btag = 0; 4 > btag; ++btag)
+        {
+            bsm::Jet::BTag *pb_btag = pb_jet->add_btag();
+            pb_btag->set_type(bsm::Jet::BTag::TCHE);
+            pb_btag->set_discriminator(rand() % 10);
+        }
+    }
+
+    bsm::Event::TriggerInfo *hlt = event.mutable_hlt();
+    for(int object = 0; sizes.trigger_objects > object; ++object)
+    {
+        bsm::TriggerObject *pb_object = hlt->add_object();
+        pb_object->set_particle_id(rand() % 25);
+        p4(pb_object->mutable_p4());
+    }
+
+    for(int filter = 0; sizes.filters > filter; ++filter)
+    {
+        bsm::TriggerFilter *pb_filter = hlt->add_filter();
+        pb_filter->set_hash(rand());
+
+        // Half of the filters store compact keys
+        //
+        if (filter % 2)
+        {
+            if (recycler)
+                recycler->addString(pb_filter,
+                        bsm::extra_field::TRIGGER_FILTER_KEYS,
+                        packed_keys);
+            else
+                bsm::utility::addString(pb_filter,
+                        bsm::extra_field::TRIGGER_FILTER_KEYS,
+                        packed_keys);
+
+            continue;
+        }
+
+        for(int key = 0; 8 > key; ++key)
+            pb_filter->add_key(rand() % sizes.trigger_objects);
+    }
+
+    for(int particle = 0; sizes.gen_particles > particle; ++particle)
+        genParticle(event.add_gen_particle(), 3);
+}
+
+static Sizes generate(const Sizes &max)
+{
+    Sizes sizes;
+    sizes.leptons = 1 + rand() % max.leptons;
+    sizes.jets = 1 + rand() % max.jets;
+    sizes.trigger_objects = 1 + rand() % max.trigger_objects;
+    sizes.filters = 1 + rand() % max.filters;
+    sizes.gen_particles = 1 + rand() % max.gen_particles;
+
+    return sizes;
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace posix_time;
+
+    const size_t events = 1 < argc ? lexical_cast<size_t>(argv[1]) : 20000;
+    const size_t warm_up = 2 < argc ? lexical_cast<size_t>(argv[2]) : 1000;
+
+    Sizes max;
+    max.leptons = 4;
+    max.jets = 20;
+    max.trigger_objects = 2000;
+    max.filters = 100;
+    max.gen_particles = 4;
+
+    edm::ParameterSet config;
+    config.addParameter<uint32_t>("sample_every", 0);
+    config.addParameter<uint32_t>("max_bytes", 0);
+
+    cout << "events: " << events << " warm-up: " << warm_up << endl;
+    cout << setw(10) << "strategy"
+        << setw(14) << "allocs/event"
+        << setw(12) << "ns/event"
+        << endl;
+
+    // New message per event
+    //
+    {
+        srand(1);
+        for(size_t event = 0; warm_up > event; ++event)
+        {
+            bsm::Event pb_event;
+            build(pb_event, generate(max));
+        }
+
+        const uint64_t start_allocations = allocations;
+        const ptime start = microsec_clock::universal_time();
+        for(size_t event = 0; events > event; ++event)
+        {
+            bsm::Event pb_event;
+            build(pb_event, generate(max));
+        }
+
+        const double time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        cout << setw(10) << "fresh"
+            << setw(14)
+            << static_cast<double>(allocations - start_allocations) / events
+            << setw(12) << 1e3 * time / events
+            << endl;
+    }
+
+    // Recycled message: warm-up includes the largest event
+    //
+    uint64_t recycled_allocations = 0;
+    {
+        srand(1);
+
+        bsm::EventRecycler recycler(config);
+        boost::shared_ptr<bsm::Event> pb_event(new bsm::Event());
+
+        build(*pb_event, max, &recycler);
+        for(size_t event = 0; warm_up > event; ++event)
+        {
+            recycler.recycle(pb_event);
+            build(*pb_event, generate(max), &recycler);
+        }
+
+        const uint64_t start_allocations = allocations;
+        const ptime start = microsec_clock::universal_time();
+        for(size_t event = 0; events > event; ++event)
+        {
+            recycler.recycle(pb_event);
+            build(*pb_event, generate(max), &recycler);
+        }
+
+        const double time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        recycled_allocations = allocations - start_allocations;
+
+        cout << setw(10) << "recycled"
+            << setw(14) << static_cast<double>(recycled_allocations) / events
+            << setw(12) << 1e3 * time / events
+            << endl;
+    }
+
+    // Warm-up has seen the largest event: nothing is allocated after it
+    //
+    if (recycled_allocations)
+    {
+        cerr << "recycled events allocated " << recycled_allocations
+            << " times after warm-up" << endl;
+
+        return 1;
+    }
+
+    return 0;
+}
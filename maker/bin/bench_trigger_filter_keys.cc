@@ -0,0 +1,370 @@
+// Round trip of the compact trigger filter keys: encode random events,
+// write and read them back, and decode every filter. Truncated and
+// corrupted keys are checked too
+//
+// Created by Samvel Khalatyan, Mar 21, 2012
+// Copyright 2012, All rights reserved
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <google/protobuf/unknown_field_set.h>
+
+#include "bsm_input_maker/bsm_input/interface/Event.pb.h"
+#include "bsm_input_maker/bsm_input/interface/Trigger.pb.h"
+#include "bsm_input_maker/maker/interface/ExtraFields.h"
+#include "bsm_input_maker/maker/interface/TriggerFilterKeys.h"
+#include "bsm_input_maker/maker/interface/Utility.h"
+
+using namespace std;
+using namespace boost;
+
+using bsm::TriggerFilterKeys;
+
+typedef TriggerFilterKeys::Keys Keys;
+typedef TriggerFilterKeys::Filters Filters;
+
+// Keys in the proportions of the production filters: repeats of the
+// earlier filters, dense ascending, ascending with gaps, unordered and
+// empty
+//
+static Keys generate(const vector<Keys> &filters)
+{
+    Keys keys;
+
+    switch(rand() % 6)
+    {
+        case 0:
+            // Repeat of the recent filter, sometimes out of the encoder
+            // window
+            //
+            if (!filters.empty())
+                keys = filters[filters.size() - 1
+                    - rand() % min<size_t>(filters.size(), 12)];
+
+            break;
+
+        case 1:
+        {
+            const uint32_t first = rand() % 2000;
+            for(int key = 0, size = rand() % 60; size > key; ++key)
+            {
+                if (rand() % 3)
+                    keys.push_back(first + key);
+            }
+
+            break;
+        }
+
+        case 2:
+        {
+            uint32_t key = rand() % 300;
+            for(int size = rand() % 8; size; --size)
+            {
+                key += 1 + rand() % 40;
+                keys.push_back(key);
+            }
+
+            break;
+        }
+
+        case 3:
+            for(int size = rand() % 10; size; --size)
+                keys.push_back(rand() % 100000);
+
+            break;
+
+        case 4:
+            // Large keys take several varint bytes
+            //
+            for(int size = 1 + rand() % 4; size; --size)
+                keys.push_back(0xfffff000u + rand() % 4096);
+
+            break;
+
+        default:
+            break;
+    }
+
+    return keys;
+}
+
+static string *encoded(bsm::TriggerFilter *filter)
+{
+    google::protobuf::UnknownFieldSet *fields =
+        filter->mutable_unknown_fields();
+
+    for(int field = 0; fields->field_count() > field; ++field)
+    {
+        if (bsm::extra_field::TRIGGER_FILTER_KEYS
+                == fields->field(field).number())
+            return fields->mutable_field(field)->mutable_length_delimited();
+    }
+
+    return 0;
+}
+
+static bool isPrefix(const Keys &prefix, const Keys &keys)
+{
+    return prefix.size() <= keys.size()
+        && equal(prefix.begin(), prefix.end(), keys.begin());
+}
+
+// Decoded truncated keys are dropped or, for bitmap, cut: either way they
+// are a prefix of the original keys
+//
+static uint64_t truncate(Filters &filters,
+        const vector<Keys> &originals,
+        Keys &keys)
+{
+    uint64_t failures = 0;
+    for(int filter = 0; filters.size() > filter; ++filter)
+    {
+        string *bytes = encoded(filters.Mutable(filter));
+        if (!bytes)
+            continue;
+
+        const string original = *bytes;
+        for(size_t size = 0; original.size() > size; ++size)
+        {
+            bytes->assign(original, 0, size);
+
+            TriggerFilterKeys::decode(filters, filter, keys);
+            if (!isPrefix(keys, originals[filter]))
+                ++failures;
+        }
+
+        *bytes = original;
+    }
+
+    return failures;
+}
+
+static void addVarint(string &out, uint64_t value)
+{
+    for(; 0x80 <= value; value >>= 7)
+        out.push_back(static_cast<char>(value | 0x80));
+
+    out.push_back(static_cast<char>(value));
+}
+
+// Single filter event with given bytes: decoded keys should be empty and
+// memory is reserved for at most a key per byte
+//
+static bool corrupted(const string &name, const string &bytes)
+{
+    bsm::Event event;
+    bsm::TriggerFilter *filter = event.mutable_hlt()->add_filter();
+    filter->set_hash(1);
+    bsm::utility::addString(filter,
+            bsm::extra_field::TRIGGER_FILTER_KEYS,
+            bytes);
+
+    Keys keys;
+    TriggerFilterKeys::decode(event.hlt().filter(), 0, keys);
+
+    const bool is_passed = keys.empty() && bytes.size() >= keys.capacity();
+
+    cout << setw(28) << name << " keys " << setw(4) << keys.size()
+        << " capacity " << setw(4) << keys.capacity()
+        << (is_passed ? "  OK" : "  FAILED") << endl;
+
+    return is_passed;
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace posix_time;
+
+    const size_t events = 1 < argc ? lexical_cast<size_t>(argv[1]) : 2000;
+    const int max_filters = 2 < argc ? lexical_cast<int>(argv[2]) : 40;
+
+    srand(3);
+
+    TriggerFilterKeys encoder;
+
+    uint64_t modes[3] = {0, 0, 0};
+    uint64_t chains = 0;
+    uint64_t empty_filters = 0;
+    uint64_t filters = 0;
+    uint64_t plain_bytes = 0;
+    uint64_t compact_bytes = 0;
+    uint64_t mismatches = 0;
+    uint64_t truncated_failures = 0;
+
+    time_duration encode_time;
+    time_duration decode_time;
+
+    vector<Keys> originals;
+    vector<int> filter_modes;
+    Keys keys;
+    for(size_t event = 0; events > event; ++event)
+    {
+        bsm::Event plain;
+        bsm::Event compact;
+
+        originals.clear();
+        for(int filter = 0, size = rand() % (max_filters + 1);
+                size > filter;
+                ++filter)
+        {
+            originals.push_back(generate(originals));
+
+            const Keys &filter_keys = originals.back();
+
+            bsm::TriggerFilter *pb_filter = plain.mutable_hlt()->add_filter();
+            pb_filter->set_hash(filter);
+            for(Keys::const_iterator key = filter_keys.begin();
+                    filter_keys.end() != key;
+                    ++key)
+            {
+                pb_filter->add_key(*key);
+            }
+
+            compact.mutable_hlt()->add_filter()->set_hash(filter);
+        }
+
+        // Encoder state is per event
+        //
+        const ptime encode_start = microsec_clock::universal_time();
+
+        encoder.clear();
+        filter_modes.assign(originals.size(), -1);
+        for(size_t filter = 0; originals.size() > filter; ++filter)
+        {
+            const string &bytes = encoder.encode(originals[filter]);
+            if (bytes.empty())
+            {
+                ++empty_filters;
+
+                continue;
+            }
+
+            // Repeat distance is within the encoder window: one byte
+            //
+            filter_modes[filter] = static_cast<uint8_t>(bytes[0]);
+            ++modes[filter_modes[filter]];
+
+            if (TriggerFilterKeys::REPEAT == filter_modes[filter]
+                    && TriggerFilterKeys::REPEAT
+                        == filter_modes[filter - bytes[1]])
+                ++chains;
+
+            bsm::utility::addString(compact.mutable_hlt()->mutable_filter(
+                        filter),
+                    bsm::extra_field::TRIGGER_FILTER_KEYS,
+                    bytes);
+        }
+
+        encode_time += microsec_clock::universal_time() - encode_start;
+
+        filters += originals.size();
+        plain_bytes += plain.ByteSize();
+
+        string wire;
+        compact.SerializeToString(&wire);
+        compact_bytes += wire.size();
+
+        bsm::Event read;
+        read.ParseFromString(wire);
+
+        const ptime decode_start = microsec_clock::universal_time();
+
+        for(int filter = 0; read.hlt().filter().size() > filter; ++filter)
+        {
+            TriggerFilterKeys::decode(read.hlt().filter(), filter, keys);
+            if (keys != originals[filter])
+                ++mismatches;
+        }
+
+        decode_time += microsec_clock::universal_time() - decode_start;
+
+        // Plain key field is decoded as is
+        //
+        for(int filter = 0; plain.hlt().filter().size() > filter; ++filter)
+        {
+            TriggerFilterKeys::decode(plain.hlt().filter(), filter, keys);
+            if (keys != originals[filter])
+                ++mismatches;
+        }
+
+        truncated_failures += truncate(*read.mutable_hlt()->mutable_filter(),
+                originals, keys);
+    }
+
+    cout << "events: " << events << " filters: " << filters << endl;
+    cout << "delta " << modes[TriggerFilterKeys::DELTA]
+        << " bitmap " << modes[TriggerFilterKeys::BITMAP]
+        << " repeat " << modes[TriggerFilterKeys::REPEAT]
+        << " (chained " << chains << ")"
+        << " empty " << empty_filters << endl;
+    cout << "bytes: plain " << plain_bytes
+        << " compact " << compact_bytes << endl;
+    cout << "encode " << 1e3 * encode_time.total_microseconds() / events
+        << " ns/event, decode "
+        << 1e3 * decode_time.total_microseconds() / events
+        << " ns/event" << endl;
+    cout << "mismatches " << mismatches
+        << " truncated failures " << truncated_failures << endl;
+
+    bool is_passed = !mismatches && !truncated_failures;
+
+    // Counts and distances that do not fit the bytes
+    //
+    string bytes(1, static_cast<char>(TriggerFilterKeys::DELTA));
+    addVarint(bytes, 1ULL << 40);
+    bytes += "\x02\x02";
+    is_passed = corrupted("oversized delta count", bytes) && is_passed;
+
+    bytes.assign(1, static_cast<char>(TriggerFilterKeys::DELTA));
+    addVarint(bytes, 3);
+    bytes += "\x02\x02";
+    is_passed = corrupted("delta count above keys", bytes) && is_passed;
+
+    bytes.assign(1, static_cast<char>(TriggerFilterKeys::DELTA));
+    addVarint(bytes, 1);
+    bytes += "\xff\xff";
+    is_passed = corrupted("truncated delta key", bytes) && is_passed;
+
+    bytes.assign(1, static_cast<char>(TriggerFilterKeys::REPEAT));
+    addVarint(bytes, 1);
+    is_passed = corrupted("repeat before first filter", bytes) && is_passed;
+
+    bytes.assign(1, static_cast<char>(TriggerFilterKeys::REPEAT));
+    addVarint(bytes, 0);
+    is_passed = corrupted("repeat of itself", bytes) && is_passed;
+
+    bytes.assign(1, static_cast<char>(TriggerFilterKeys::REPEAT));
+    bytes += "\x80\x80";
+    is_passed = corrupted("truncated repeat distance", bytes) && is_passed;
+
+    bytes.assign(1, static_cast<char>(TriggerFilterKeys::REPEAT + 1));
+    addVarint(bytes, 1);
+    is_passed = corrupted("unknown mode", bytes) && is_passed;
+
+    is_passed = corrupted("empty bytes", "") && is_passed;
+
+    // Every mode and repeat chains should be covered
+    //
+    if (!modes[TriggerFilterKeys::DELTA]
+            || !modes[TriggerFilterKeys::BITMAP]
+            || !modes[TriggerFilterKeys::REPEAT]
+            || !chains
+            || !empty_filters)
+    {
+        cerr << "not every mode is covered" << endl;
+
+        is_passed = false;
+    }
+
+    return is_passed ? 0 : 1;
+}
@@ -0,0 +1,323 @@
+// Benchmark ttbar hypotheses: brute force over all jet assignments vs
+// pruned search, and pruned search in threads over events
+//
+// Created by Samvel Khalatyan, Mar 19, 2012
+// Copyright 2012, All rights reserved
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "bsm_input_maker/maker/interface/TtbarHypotheses.h"
+
+using namespace std;
+using namespace boost;
+
+using bsm::TtbarHypotheses;
+
+typedef TtbarHypotheses::LorentzVector LorentzVector;
+
+struct Event
+{
+    LorentzVector lepton;
+    double met_px;
+    double met_py;
+
+    TtbarHypotheses::LorentzVectors jets;
+    TtbarHypotheses::Floats btags;
+};
+
+typedef vector<Event> Events;
+
+static double uniform(const double &min, const double &max)
+{
+    return min + (max - min) * (static_cast<double>(rand()) / RAND_MAX);
+}
+
+static LorentzVector massless(const double &pt)
+{
+    const double eta = uniform(-2.4, 2.4);
+    const double phi = uniform(-M_PI, M_PI);
+
+    const double pz = pt * sinh(eta);
+
+    return LorentzVector(pt * cos(phi), pt * sin(phi), pz,
+            sqrt(pt * pt + pz * pz));
+}
+
+// Jets are in the pt order, about two of them are b-tagged
+//
+static void generate(Events &events, const size_t &size,
+        const int &max_jets)
+{
+    events.resize(size);
+    for(Events::iterator event = events.begin(); events.end() != event;
+            ++event)
+    {
+        event->lepton = massless(uniform(30, 150));
+        event->met_px = uniform(-100, 100);
+        event->met_py = uniform(-100, 100);
+
+        const int jets = 4 + rand() % (max_jets - 3);
+
+        vector<double> pt(jets);
+        for(int jet = 0; jets > jet; ++jet)
+            pt[jet] = uniform(30, 250);
+
+        sort(pt.begin(), pt.end(), greater<double>());
+
+        event->jets.clear();
+        event->btags.clear();
+        for(int jet = 0; jets > jet; ++jet)
+        {
+            event->jets.push_back(massless(pt[jet]));
+            event->btags.push_back(0 == rand() % 3
+                    ? uniform(3.3, 10)
+                    : uniform(-1, 3.3));
+        }
+    }
+}
+
+// Every assignment of the leading jets with the same chi2 definition
+//
+static void brute(const edm::ParameterSet &config,
+        const TtbarHypotheses &hypotheses,
+        const Event &event,
+        TtbarHypotheses::Hypotheses &result)
+{
+    const uint32_t max_hypotheses =
+        config.getParameter<uint32_t>("max_hypotheses");
+    const double btag_cut = config.getParameter<double>("btag_cut");
+    const double w_mass = config.getParameter<double>("w_mass");
+    const double w_sigma = config.getParameter<double>("w_sigma");
+    const double top_mass = config.getParameter<double>("top_mass");
+    const double top_sigma = config.getParameter<double>("top_sigma");
+    const double max_pull = config.getParameter<double>("max_pull");
+
+    result.clear();
+
+    const int jets = min<int>(event.jets.size(),
+            config.getParameter<uint32_t>("max_jets"));
+    if (4 > jets)
+        return;
+
+    LorentzVector neutrinos[2];
+    const int solutions = hypotheses.neutrino(event.lepton,
+            event.met_px, event.met_py, neutrinos);
+
+    int tagged = 0;
+    for(int jet = 0; jets > jet; ++jet)
+    {
+        if (btag_cut <= event.btags[jet])
+            ++tagged;
+    }
+
+    const bool use_tags = 2 <= tagged;
+
+    TtbarHypotheses::Hypothesis hypothesis;
+    for(int hadronic_b = 0; jets > hadronic_b; ++hadronic_b)
+    for(int first = 0; jets > first; ++first)
+    for(int second = first + 1; jets > second; ++second)
+    for(int leptonic_b = 0; jets > leptonic_b; ++leptonic_b)
+    for(int solution = 0; solutions > solution; ++solution)
+    {
+        if (hadronic_b == first
+                || hadronic_b == second
+                || leptonic_b == hadronic_b
+                || leptonic_b == first
+                || leptonic_b == second)
+            continue;
+
+        if (use_tags
+                && (btag_cut > event.btags[hadronic_b]
+                    || btag_cut > event.btags[leptonic_b]))
+            continue;
+
+        const LorentzVector w = event.jets[first] + event.jets[second];
+        const double w_pull = (w.M() - w_mass) / w_sigma;
+        const double hadronic_pull =
+            ((w + event.jets[hadronic_b]).M() - top_mass) / top_sigma;
+        const double leptonic_pull = ((event.lepton + neutrinos[solution]
+                    + event.jets[leptonic_b]).M() - top_mass) / top_sigma;
+
+        if (max_pull < fabs(w_pull)
+                || max_pull < fabs(hadronic_pull)
+                || max_pull < fabs(leptonic_pull))
+            continue;
+
+        hypothesis.leptonic_b = leptonic_b;
+        hypothesis.hadronic_b = hadronic_b;
+        hypothesis.first_quark = first;
+        hypothesis.second_quark = second;
+        hypothesis.neutrino = solution;
+        hypothesis.chi2 = w_pull * w_pull
+            + hadronic_pull * hadronic_pull
+            + leptonic_pull * leptonic_pull;
+
+        result.push_back(hypothesis);
+    }
+
+    TtbarHypotheses::Hypotheses::iterator last = result.begin()
+        + min<size_t>(result.size(), max_hypotheses);
+
+    partial_sort(result.begin(), last, result.end(),
+            bind(&TtbarHypotheses::Hypothesis::chi2, _1)
+                < bind(&TtbarHypotheses::Hypothesis::chi2, _2));
+
+    result.erase(last, result.end());
+}
+
+// Every thread processes every n-th event with own output
+//
+static void reconstruct(const TtbarHypotheses *hypotheses,
+        const Events *events,
+        const size_t first,
+        const size_t step,
+        size_t *kept)
+{
+    TtbarHypotheses::Hypotheses result;
+    for(size_t event = first, size = events->size(); size > event;
+            event += step)
+    {
+        const Event &input = (*events)[event];
+        hypotheses->reconstruct(input.lepton,
+                input.met_px, input.met_py,
+                input.jets, input.btags,
+                result);
+
+        *kept += result.size();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    using namespace posix_time;
+
+    const size_t events_size =
+        1 < argc ? lexical_cast<size_t>(argv[1]) : 20000;
+    const int max_jets = 2 < argc ? lexical_cast<int>(argv[2]) : 8;
+    const int max_threads = 3 < argc
+        ? lexical_cast<int>(argv[3])
+        : max<int>(thread::hardware_concurrency(), 1);
+
+    edm::ParameterSet config;
+    config.addParameter<uint32_t>("max_jets", max_jets);
+    config.addParameter<uint32_t>("max_hypotheses", 5);
+    config.addParameter<string>("btag", "trackCountingHighEffBJetTags");
+    config.addParameter<double>("btag_cut", 3.3);
+    config.addParameter<double>("w_mass", 80.4);
+    config.addParameter<double>("w_sigma", 10);
+    config.addParameter<double>("top_mass", 172.5);
+    config.addParameter<double>("top_sigma", 15);
+    config.addParameter<double>("max_pull", 3);
+
+    const TtbarHypotheses hypotheses(config);
+
+    srand(1);
+
+    Events events;
+    generate(events, events_size, max_jets);
+
+    cout << "events: " << events_size << " max jets: " << max_jets << endl;
+
+    // Pruned search should keep the same chi2 as brute force
+    //
+    TtbarHypotheses::Hypotheses brute_result;
+    TtbarHypotheses::Hypotheses pruned_result;
+
+    size_t mismatches = 0;
+    double brute_time = 0;
+    double pruned_time = 0;
+    for(Events::const_iterator event = events.begin(); events.end() != event;
+            ++event)
+    {
+        ptime start = microsec_clock::universal_time();
+        brute(config, hypotheses, *event, brute_result);
+        brute_time +=
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        start = microsec_clock::universal_time();
+        hypotheses.reconstruct(event->lepton,
+                event->met_px, event->met_py,
+                event->jets, event->btags,
+                pruned_result);
+        pruned_time +=
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        bool is_equal = brute_result.size() == pruned_result.size();
+        for(size_t i = 0; is_equal && brute_result.size() > i; ++i)
+            is_equal = brute_result[i].chi2 == pruned_result[i].chi2;
+
+        if (!is_equal)
+            ++mismatches;
+    }
+
+    cout << setw(10) << "search"
+        << setw(12) << "ns/event"
+        << endl;
+
+    cout << setw(10) << "brute"
+        << setw(12) << 1e3 * brute_time / events_size
+        << endl;
+
+    cout << setw(10) << "pruned"
+        << setw(12) << 1e3 * pruned_time / events_size
+        << endl;
+
+    // Threads share one configuration
+    //
+    cout << endl;
+    cout << setw(10) << "threads"
+        << setw(12) << "ns/event"
+        << setw(10) << "speed-up"
+        << endl;
+
+    double single_time = 0;
+    for(int threads = 1; max_threads >= threads; threads *= 2)
+    {
+        vector<size_t> kept(threads, 0);
+
+        const ptime start = microsec_clock::universal_time();
+
+        thread_group group;
+        for(int thread = 0; threads > thread; ++thread)
+            group.create_thread(boost::bind(&reconstruct,
+                        &hypotheses, &events,
+                        thread, threads, &kept[thread]));
+
+        group.join_all();
+
+        const double time =
+            (microsec_clock::universal_time() - start).total_microseconds();
+
+        if (1 == threads)
+            single_time = time;
+
+        cout << setw(10) << threads
+            << setw(12) << 1e3 * time / events_size
+            << setw(10) << setprecision(3) << single_time / time
+            << endl;
+    }
+
+    if (mismatches)
+    {
+        cerr << mismatches << " events differ from brute force" << endl;
+
+        return 1;
+    }
+
+    return 0;
+}
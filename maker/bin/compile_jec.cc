@@ -0,0 +1,74 @@
+// Convert JEC text files into binary cache loaded by JetSelector
+//
+// Created by Samvel Khalatyan, Feb 24, 2012
+// Copyright 2012, All rights reserved
+
+#include <iostream>
+#include <string>
+
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/JECCache.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    if (2 > argc)
+    {
+        cerr << "usage: " << argv[0] << " jec.txt [jec.txt ...]" << endl;
+        cerr << endl;
+        cerr << "Binary cache is written next to each text file as "
+            << bsm::jec::binaryFilename("jec.txt") << endl;
+
+        return 1;
+    }
+
+    int result = 0;
+    for(int arg = 1; argc > arg; ++arg)
+    {
+        const string text_filename(argv[arg]);
+        const string binary_filename = bsm::jec::binaryFilename(text_filename);
+
+        try
+        {
+            if (!bsm::jec::compile(text_filename, binary_filename))
+            {
+                cerr << "failed to write " << binary_filename << endl;
+
+                result = 1;
+
+                continue;
+            }
+
+            // Verify that cache is accepted by the loader
+            //
+            JetCorrectorParameters parameters;
+            if (!bsm::jec::load(binary_filename,
+                        bsm::jec::checksum(text_filename),
+                        parameters)
+                    || JetCorrectorParameters(text_filename).size()
+                        != parameters.size())
+            {
+                cerr << "failed to verify " << binary_filename << endl;
+
+                result = 1;
+
+                continue;
+            }
+
+            cout << text_filename << " -> " << binary_filename
+                << " [" << parameters.size() << " records]" << endl;
+        }
+        catch(const cms::Exception &error)
+        {
+            cerr << "failed to compile " << text_filename << ": "
+                << error.what() << endl;
+
+            result = 1;
+        }
+    }
+
+    return result;
+}
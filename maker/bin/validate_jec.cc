@@ -0,0 +1,338 @@
+// Compare BatchJetCorrector with FactorizedJetCorrector on JEC text files.
+// Built-in definitions are checked if no files are given
+//
+// Created by Samvel Khalatyan, Feb 25, 2012
+// Copyright 2012, All rights reserved
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <boost/lexical_cast.hpp>
+
+#include "CondFormats/JetMETObjects/interface/FactorizedJetCorrector.h"
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/BatchJetCorrector.h"
+
+using namespace std;
+using namespace boost;
+
+using bsm::BatchJetCorrector;
+
+typedef BatchJetCorrector::Floats Floats;
+
+// Built-in levels in the format of the JEC text files: L1FastJet with rho,
+// pt and area, pt only levels are tabulated in the grid mode
+//
+static const char *BUILTIN_LEVELS[] =
+{
+    "{1 JetEta 3 Rho JetPt JetA "
+        "max(0.0001,1-(z*([0]+[1]*(x-[2]))*(1+[3]*log(y)))/y) "
+        "Correction L1FastJet}\n"
+    "-5.191 -2.5 10 0 200 1 6500 0 10 0.35 0.82 1.4 0.012\n"
+    "-2.5 0 10 0 200 1 6500 0 10 0.21 0.76 1.1 0.018\n"
+    "0 2.5 10 0 200 1 6500 0 10 0.22 0.75 1.2 0.017\n"
+    "2.5 5.191 10 0 200 1 6500 0 10 0.33 0.84 1.3 0.011\n",
+
+    "{1 JetEta 1 JetPt "
+        "[0]+[1]*log10(x)+[2]*pow(log10(x),2)+[3]/x "
+        "Correction L2Relative}\n"
+    "-5.191 -3.0 6 10 500 1.31 -0.21 0.031 1.9\n"
+    "-3.0 -1.3 6 6 2000 1.12 -0.07 0.012 1.2\n"
+    "-1.3 0 6 4 3000 1.04 -0.03 0.006 0.8\n"
+    "0 1.3 6 4 3000 1.05 -0.03 0.005 0.9\n"
+    "1.3 3.0 6 6 2000 1.11 -0.06 0.011 1.3\n"
+    "3.0 5.191 6 10 500 1.29 -0.19 0.029 2.1\n",
+
+    "{1 JetEta 1 JetPt [0]+[1]/x Correction L3Absolute}\n"
+    "-5.191 5.191 4 4 5000 0.987 0.45\n"
+};
+
+// Scan of the jet phase space: all (eta, pt, area) jets are corrected at
+// once for every rho
+//
+struct Scan
+{
+    Floats eta;
+    Floats pt;
+    Floats energy;
+    Floats area;
+
+    Floats rho;
+};
+
+// The largest relative deviation from the reference correction
+//
+struct Deviation
+{
+    Deviation():
+        value(0),
+        eta(0),
+        pt(0),
+        area(0),
+        rho(0),
+        reference(0),
+        correction(0)
+    {
+    }
+
+    float value;
+
+    float eta;
+    float pt;
+    float area;
+    float rho;
+
+    float reference;
+    float correction;
+};
+
+static Scan scan()
+{
+    Scan result;
+
+    const float areas[] = {0.2, 0.5, 0.8, 1.2};
+    for(int eta_bin = 0; 95 > eta_bin; ++eta_bin)
+    {
+        const float eta = -4.7 + 0.1 * eta_bin + 0.013;
+
+        // Log-uniform pt from 5 GeV to 4 TeV, off the grid nodes
+        //
+        for(int pt_bin = 0; 60 > pt_bin; ++pt_bin)
+        {
+            const float pt = 5 * pow(800.0, (pt_bin + 0.37) / 60);
+
+            for(size_t area = 0; sizeof(areas) / sizeof(areas[0]) > area;
+                    ++area)
+            {
+                result.eta.push_back(eta);
+                result.pt.push_back(pt);
+                result.energy.push_back(pt * cosh(eta));
+                result.area.push_back(areas[area]);
+            }
+        }
+    }
+
+    const float rhos[] = {0, 2.5, 7, 12, 20, 35};
+    result.rho.assign(rhos, rhos + sizeof(rhos) / sizeof(rhos[0]));
+
+    return result;
+}
+
+static Deviation compare(const Scan &scan,
+        const Floats &references,
+        BatchJetCorrector &corrector)
+{
+    Deviation deviation;
+
+    Floats corrections;
+    for(size_t rho = 0; scan.rho.size() > rho; ++rho)
+    {
+        // Number of primary vertices follows rho
+        //
+        corrector.correct(scan.eta, scan.pt, scan.energy, scan.area,
+                scan.rho[rho], scan.rho[rho], corrections);
+
+        for(size_t jet = 0; scan.eta.size() > jet; ++jet)
+        {
+            const float &reference =
+                references[rho * scan.eta.size() + jet];
+            const float value = reference
+                ? fabs(corrections[jet] / reference - 1)
+                : fabs(corrections[jet]);
+
+            // NaN is the worst deviation
+            //
+            if (!(value <= deviation.value))
+            {
+                deviation.value = value;
+                deviation.eta = scan.eta[jet];
+                deviation.pt = scan.pt[jet];
+                deviation.area = scan.area[jet];
+                deviation.rho = scan.rho[rho];
+                deviation.reference = reference;
+                deviation.correction = corrections[jet];
+
+                if (value != value)
+                    return deviation;
+            }
+        }
+    }
+
+    return deviation;
+}
+
+static bool report(const string &mode,
+        const Deviation &deviation,
+        const float &tolerance)
+{
+    const bool is_passed = deviation.value <= tolerance;
+
+    cout << setw(6) << mode
+        << " max deviation " << setw(12) << deviation.value
+        << " tolerance " << setw(10) << tolerance
+        << (is_passed ? "  OK" : "  FAILED") << endl;
+
+    if (deviation.value)
+        cout << "       at eta " << deviation.eta
+            << " pt " << deviation.pt
+            << " area " << deviation.area
+            << " rho " << deviation.rho
+            << ": " << deviation.correction
+            << " vs " << deviation.reference << endl;
+
+    return is_passed;
+}
+
+// Load built-in level from the temporary text file
+//
+static JetCorrectorParameters builtin(const char *level)
+{
+    char filename[] = "/tmp/bsm_validate_jec_XXXXXX";
+
+    const int file = mkstemp(filename);
+    if (0 > file)
+        throw cms::Exception("validate_jec")
+            << "failed to create " << filename << ": " << strerror(errno);
+
+    const size_t size = strlen(level);
+    const bool is_written = write(file, level, size)
+        == static_cast<ssize_t>(size);
+
+    close(file);
+
+    if (!is_written)
+    {
+        unlink(filename);
+
+        throw cms::Exception("validate_jec")
+            << "failed to write " << filename;
+    }
+
+    const JetCorrectorParameters parameters(filename);
+
+    unlink(filename);
+
+    return parameters;
+}
+
+static bool validate(const BatchJetCorrector::Parameters &parameters,
+        const float &tolerance,
+        const uint32_t &grid_points,
+        const float &grid_tolerance)
+{
+    const Scan jets = scan();
+
+    // Reference corrections: rho-major as the batch is evaluated
+    //
+    FactorizedJetCorrector reference(parameters);
+
+    Floats references;
+    references.reserve(jets.rho.size() * jets.eta.size());
+    for(size_t rho = 0; jets.rho.size() > rho; ++rho)
+    {
+        for(size_t jet = 0; jets.eta.size() > jet; ++jet)
+        {
+            reference.setJetEta(jets.eta[jet]);
+            reference.setJetPt(jets.pt[jet]);
+            reference.setJetE(jets.energy[jet]);
+            reference.setJetA(jets.area[jet]);
+            reference.setRho(jets.rho[rho]);
+            reference.setNPV(jets.rho[rho]);
+
+            references.push_back(reference.getCorrection());
+        }
+    }
+
+    cout << parameters.size() << " levels, "
+        << references.size() << " points" << endl;
+
+    BatchJetCorrector exact(parameters);
+    bool is_passed = report("exact",
+            compare(jets, references, exact),
+            tolerance);
+
+    // Deviations of the tabulated levels multiply in the total
+    //
+    if (grid_points)
+    {
+        BatchJetCorrector grid(parameters);
+        grid.useGrid(grid_points, grid_tolerance);
+
+        is_passed = report("grid",
+                compare(jets, references, grid),
+                tolerance + parameters.size() * grid_tolerance)
+            && is_passed;
+    }
+
+    return is_passed;
+}
+
+int main(int argc, char *argv[])
+{
+    if (1 != argc
+            && 5 > argc)
+    {
+        cerr << "usage: " << argv[0]
+            << " [tolerance grid_points grid_tolerance jec.txt [jec.txt ...]]"
+            << endl;
+        cerr << endl;
+        cerr << "Levels are given in the order of application. Corrections "
+            << "are compared" << endl;
+        cerr << "with FactorizedJetCorrector over (eta, pt, area, rho) scan. "
+            << "Exact mode" << endl;
+        cerr << "fails above tolerance, grid mode fails above grid_tolerance "
+            << "per level." << endl;
+        cerr << "Without arguments built-in L1FastJet, L2Relative and "
+            << "L3Absolute are checked" << endl;
+
+        return 1;
+    }
+
+    try
+    {
+        BatchJetCorrector::Parameters parameters;
+        if (1 == argc)
+        {
+            for(size_t level = 0;
+                    sizeof(BUILTIN_LEVELS) / sizeof(BUILTIN_LEVELS[0]) > level;
+                    ++level)
+            {
+                parameters.push_back(builtin(BUILTIN_LEVELS[level]));
+            }
+
+            return validate(parameters, 1e-5, 64, 1e-3) ? 0 : 1;
+        }
+
+        const float tolerance = lexical_cast<float>(argv[1]);
+        const uint32_t grid_points = lexical_cast<uint32_t>(argv[2]);
+        const float grid_tolerance = lexical_cast<float>(argv[3]);
+
+        for(int arg = 4; argc > arg; ++arg)
+            parameters.push_back(JetCorrectorParameters(argv[arg]));
+
+        return validate(parameters, tolerance, grid_points, grid_tolerance)
+            ? 0
+            : 1;
+    }
+    catch(const bad_lexical_cast &error)
+    {
+        cerr << "invalid argument: " << error.what() << endl;
+    }
+    catch(const cms::Exception &error)
+    {
+        cerr << "failed to load corrections: " << error.what() << endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,73 @@
+// Apply factorized Jet Energy Corrections to all jets in the event at once
+//
+// Created by Samvel Khalatyan, Feb 23, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_BATCH_JET_CORRECTOR
+#define BSM_BATCH_JET_CORRECTOR
+
+#include <stdint.h>
+
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+class JetCorrectorParameters;
+
+namespace bsm
+{
+    // Evaluate the same corrections as FactorizedJetCorrector: levels are
+    // applied in order, and jet pt and energy are scaled after each level.
+    // Formulas are compiled and records parameters are converted once at
+    // construction. Each level locates the jet bin once with binary search
+    //
+    class BatchJetCorrector
+    {
+        public:
+            typedef std::vector<JetCorrectorParameters> Parameters;
+            typedef std::vector<float> Floats;
+
+            BatchJetCorrector(const Parameters &);
+
+            // Tabulate levels that depend on jet pt only with points nodes
+            // in log(pt) per bin and interpolate linearly between nodes.
+            // Grid is validated at the middle of every interval and is not
+            // used for a level if the relative deviation from the exact
+            // correction exceeds tolerance
+            //
+            void useGrid(const uint32_t &points, const float &tolerance);
+
+            // Calculate total corrections for all jets. Input arrays should
+            // have the same size: corrections are resized to match
+            //
+            void correct(const Floats &eta,
+                    const Floats &pt,
+                    const Floats &energy,
+                    const Floats &area,
+                    const float &rho,
+                    const float &npv,
+                    Floats &corrections);
+
+            enum Variable
+            {
+                JET_ETA = 0,
+                JET_PT,
+                JET_E,
+                JET_A,
+                RHO,
+                NPV,
+
+                VARIABLES
+            };
+
+        private:
+            class Level;
+
+            typedef boost::shared_ptr<Level> LevelPtr;
+            typedef std::vector<LevelPtr> Levels;
+
+            Levels _levels;
+    };
+}
+
+#endif
@@ -0,0 +1,118 @@
+// Serialized bytes per event field for the output size budget
+//
+// Created by Samvel Khalatyan, Mar 20, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_BYTE_BUDGET
+#define BSM_BYTE_BUDGET
+
+#include <stdint.h>
+
+#include <iosfwd>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace google
+{
+    namespace protobuf
+    {
+        class Descriptor;
+        class Message;
+    }
+}
+
+namespace bsm
+{
+    // Every N-th event is measured with one ByteSize call: sizes of nested
+    // messages are then read from the cache while fields are walked with
+    // reflection. Bytes include tags and length prefixes and are accounted
+    //
+    //  - per field path up to the depth, e.g. jet, jet.btag; unknown
+    //    (extra) fields are named by number, e.g. jet.[1000]
+    //  - per message type at any depth, e.g. bsm.LorentzVector
+    //
+    // Budget is reported as tables ranked by bytes and written as JSON:
+    //
+    //  {"events": N, "samples": N, "bytes": N,
+    //   "fields": [[path, bytes, elements], ...],
+    //   "types": [[type, bytes, elements], ...]}
+    //
+    class ByteBudget
+    {
+        public:
+            // Sampling is disabled if sample_every is 0
+            //
+            ByteBudget(const edm::ParameterSet &);
+
+            bool isEnabled() const;
+
+            // Measure event if it is sampled
+            //
+            void sample(const google::protobuf::Message &);
+
+            uint64_t events() const;
+            uint64_t samples() const;
+
+            void report(std::ostream &) const;
+            bool write(const std::string &filename) const;
+
+        private:
+            struct Entry
+            {
+                Entry();
+
+                std::string name;
+
+                uint64_t bytes;
+                uint64_t elements;
+            };
+
+            typedef std::vector<Entry> Entries;
+
+            // (parent entry, field number) -> entry
+            //
+            typedef std::map<std::pair<uint32_t, int>, uint32_t> Paths;
+            typedef std::map<const google::protobuf::Descriptor *, Entry>
+                Types;
+
+            // Path entries are skipped below the depth, types are accounted
+            // for the whole message
+            //
+            void account(const google::protobuf::Message &,
+                    const uint32_t &entry,
+                    const uint32_t &level);
+
+            // Entry of the path if it is already seen
+            //
+            uint32_t path(const uint32_t &parent, const int &number) const;
+            uint32_t addPath(const uint32_t &parent,
+                    const int &number,
+                    const std::string &name);
+
+            // Entries in the bytes order
+            //
+            Entries fields() const;
+            Entries types() const;
+
+            uint32_t _sample_every;
+            uint32_t _depth;
+
+            uint64_t _events;
+            uint64_t _samples;
+
+            // Entry 0 is the whole event
+            //
+            Entries _fields;
+            Paths _paths;
+            Types _types;
+    };
+}
+
+#endif
@@ -0,0 +1,70 @@
+// Event selection channel: leptons and jets multiplicity requirements
+//
+// Created by Samvel Khalatyan, Mar 5, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_CHANNEL
+#define BSM_CHANNEL
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace bsm
+{
+    // Channels are evaluated on the same selectors results, so one read of
+    // the input feeds all channels. Each multiplicity is required to be in
+    // [min, max] range, max is unlimited if not set
+    //
+    class Channel
+    {
+        public:
+            typedef std::vector<uint32_t> Counts;
+
+            Channel(const edm::ParameterSet &);
+
+            const std::string &name() const;
+
+            // Empty filename: events are written into the main stream
+            //
+            const std::string &outputFilename() const;
+
+            // Leptons are tested first: jets are selected only if any
+            // channel accepts the leptons
+            //
+            bool acceptLeptons(const uint32_t &electrons,
+                    const uint32_t &muons) const;
+
+            // Number of selected jets is given per jet variation. Return
+            // mask of variations that pass channel requirements
+            //
+            uint32_t acceptJets(const Counts &jets) const;
+
+        private:
+            struct Range
+            {
+                uint32_t min;
+                uint32_t max;
+
+                bool contains(const uint32_t &) const;
+            };
+
+            static Range range(const edm::ParameterSet &,
+                    const std::string &name);
+
+            std::string _name;
+            std::string _output_filename;
+
+            Range _electrons;
+            Range _muons;
+            Range _jets;
+    };
+}
+
+#endif
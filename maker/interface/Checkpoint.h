@@ -0,0 +1,127 @@
+// Journal of written events for the job restart
+//
+// Created by Samvel Khalatyan, Mar 23, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_CHECKPOINT
+#define BSM_CHECKPOINT
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace bsm
+{
+    // IDs of the written events are collected in blocks. Every N events
+    // the block is appended to the journal followed by the checkpoint
+    // line and the file is synced:
+    //
+    //  event run lumi event
+    //  ...
+    //  checkpoint sequence events checksum
+    //
+    // where events is the number of events written up to the checkpoint
+    // and checksum is FNV-1a of the block lines chained with the previous
+    // checkpoint checksum.
+    //
+    // Output is written in parts, one part per checkpoint: the caller
+    // closes the part files before the checkpoint and opens the next part
+    // after it. Events of the journal are therefore in complete files.
+    //
+    // Restart validates the journal: it is truncated after the last
+    // checkpoint with the expected sequence, count and checksum, and events
+    // of the valid blocks are skipped. Writing continues with the part
+    // after the last checkpoint: the part of the incomplete block is
+    // overwritten and its events are processed again
+    //
+    class Checkpoint
+    {
+        public:
+            struct Key
+            {
+                uint32_t run;
+                uint32_t lumi;
+                uint64_t event;
+
+                bool operator<(const Key &) const;
+            };
+
+            typedef std::vector<Key> Keys;
+
+            Checkpoint(const edm::ParameterSet &);
+            ~Checkpoint();
+
+            // Event is written before the last checkpoint of the previous
+            // job
+            //
+            bool isWritten(const uint32_t &run,
+                    const uint32_t &lumi,
+                    const uint64_t &event);
+
+            void add(const uint32_t &run,
+                    const uint32_t &lumi,
+                    const uint64_t &event);
+
+            // Block has every_events events
+            //
+            bool isDue() const;
+
+            // Sync the closed parts, append the block to the journal and
+            // sync it. Output part should be closed before and the next part
+            // opened after. Failed write or sync throws: the journal can not
+            // be trusted
+            //
+            void checkpoint();
+
+            // Output filename of the current part: part number is added
+            // before the extension, e.g. out_002.pb. Parts are synced at
+            // the next checkpoint
+            //
+            std::string partFilename(const std::string &filename);
+
+            // Events of the previous job: restored from journal, dropped
+            // with incomplete block and skipped in this job
+            //
+            uint64_t restored() const;
+            uint64_t dropped() const;
+            uint64_t skipped() const;
+
+            // Events written by the previous job, sorted
+            //
+            const Keys &written() const;
+
+        private:
+            // Read valid blocks and return journal size up to the last
+            // valid checkpoint
+            //
+            uint64_t restore();
+
+            std::string _filename;
+            uint32_t _every;
+
+            int _journal;
+
+            std::string _block;
+            uint32_t _block_events;
+
+            std::vector<std::string> _parts;
+
+            uint64_t _sequence;
+            uint64_t _events;
+            uint64_t _checksum;
+
+            Keys _written;
+
+            uint64_t _restored;
+            uint64_t _dropped;
+            uint64_t _skipped;
+    };
+}
+
+#endif
@@ -0,0 +1,535 @@
+// Configurable selection cuts with adaptive evaluation order
+//
+// Created by Samvel Khalatyan, Feb 29, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_CUT_ENGINE
+#define BSM_CUT_ENGINE
+
+#include <stdint.h>
+#include <time.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+namespace bsm
+{
+    // Cuts are registered by selector in the source order and compiled
+    // into a flat sequence of predicates: only cuts with a threshold in the
+    // ParameterSet are used. Boolean cuts are enabled with true value.
+    //
+    // Engine keeps per cut rejection rate and sampled cost, and reorders
+    // cuts every N objects so that cheap cuts with high rejection are
+    // evaluated first. Predicates must be safe to evaluate in any order.
+    // Cost below the timer resolution and clock_gettime overhead is not
+    // measurable: such cuts are ranked by rejection only.
+    //
+    // Cuts of a group share a precondition, e.g. lazy load of the object
+    // tracks, that is evaluated once per object before the first cut of
+    // the group. Its cost is measured separately and charged to every cut
+    // of the group: the order does not depend on which cut loads.
+    //
+    // Optional reorder_every (0 - keep order) and sample_every parameters
+    // of the ParameterSet control reordering and cost sampling frequency
+    //
+    template<typename T>
+        class CutEngine
+        {
+            public:
+                typedef bool (*Predicate)(T &, const double &threshold);
+                typedef void (*Precondition)(T &);
+
+                CutEngine(const std::string &name,
+                        const edm::ParameterSet &cuts);
+
+                ~CutEngine();
+
+                void add(const std::string &name, const Predicate &);
+
+                // Group should be added before its cuts
+                //
+                void addGroup(const std::string &group, const Precondition &);
+                void add(const std::string &name,
+                        const Predicate &,
+                        const std::string &group);
+
+                // Cut is applied outside of the engine, e.g. by vectorized
+                // kernel: the name is accepted by validate
+                //
+                void addExternal(const std::string &name);
+
+                // Throw if the ParameterSet has cuts that were not added
+                //
+                void validate() const;
+
+                bool operator()(T &);
+
+                // Evaluate cuts in the current order without statistics,
+                // e.g. for variations of the already counted object
+                //
+                bool evaluate(T &) const;
+
+                std::string summary() const;
+
+            private:
+                struct Group
+                {
+                    std::string name;
+                    Precondition precondition;
+
+                    uint64_t calls;
+
+                    uint64_t timed_calls;
+                    double time;
+                };
+
+                struct Cut
+                {
+                    std::string name;
+                    Predicate predicate;
+                    double threshold;
+
+                    // Group index, NO_GROUP if cut has no precondition
+                    //
+                    int group;
+
+                    uint64_t calls;
+                    uint64_t rejected;
+
+                    uint64_t timed_calls;
+                    double time;
+
+                    // Expected cost to reject an object, set in reorder
+                    //
+                    double rank;
+                };
+
+                typedef std::vector<Group> Groups;
+                typedef std::vector<Cut> Cuts;
+
+                enum
+                {
+                    NO_GROUP = -1,
+                    MAX_GROUPS = 32
+                };
+
+                static bool isCheaper(const Cut &, const Cut &);
+                static bool isOption(const std::string &);
+
+                // Sampled time of the call in ns without timer overhead
+                //
+                double elapsed(const timespec &start,
+                        const timespec &stop) const;
+
+                // Mean cost in ns, 0 if not measured
+                //
+                double cost(const uint64_t &timed_calls,
+                        const double &time) const;
+
+                double rank(const Cut &) const;
+
+                void reorder();
+
+                std::string _name;
+                edm::ParameterSet _config;
+
+                Groups _groups;
+                Cuts _cuts;
+                std::vector<std::string> _external;
+
+                double _timer_overhead;
+                double _min_cost;
+
+                uint32_t _reorder_every;
+                uint32_t _sample_every;
+
+                uint64_t _objects;
+                uint64_t _passed;
+        };
+}
+
+template<typename T>
+    bsm::CutEngine<T>::CutEngine(const std::string &name,
+            const edm::ParameterSet &cuts):
+        _name(name),
+        _config(cuts),
+        _timer_overhead(0),
+        _min_cost(0),
+        _reorder_every(1000),
+        _sample_every(16),
+        _objects(0),
+        _passed(0)
+{
+    if (_config.existsAs<uint32_t>("reorder_every"))
+        _reorder_every = _config.getParameter<uint32_t>("reorder_every");
+
+    if (_config.existsAs<uint32_t>("sample_every"))
+        _sample_every = std::max(
+                _config.getParameter<uint32_t>("sample_every"),
+                static_cast<uint32_t>(1));
+
+    // The shortest of a few empty intervals is subtracted from the sampled
+    // time. Cost comparable to the timer calls themselves is noise
+    //
+    const int samples = 64;
+
+    double overhead = std::numeric_limits<double>::max();
+    double total = 0;
+    for(int sample = 0; samples > sample; ++sample)
+    {
+        timespec start;
+        timespec stop;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        clock_gettime(CLOCK_MONOTONIC, &stop);
+
+        const double interval = elapsed(start, stop);
+        overhead = std::min(overhead, interval);
+        total += interval;
+    }
+
+    _timer_overhead = overhead;
+
+    timespec resolution;
+    clock_getres(CLOCK_MONOTONIC, &resolution);
+
+    _min_cost = std::max(2 * total / samples,
+            1e9 * resolution.tv_sec + resolution.tv_nsec);
+}
+
+template<typename T>
+    bsm::CutEngine<T>::~CutEngine()
+{
+    edm::LogInfo("CutEngine") << summary();
+}
+
+template<typename T>
+    void bsm::CutEngine<T>::add(const std::string &name,
+            const Predicate &predicate)
+{
+    Cut cut;
+    cut.name = name;
+    cut.predicate = predicate;
+    cut.group = NO_GROUP;
+    cut.calls = 0;
+    cut.rejected = 0;
+    cut.timed_calls = 0;
+    cut.time = 0;
+    cut.rank = 0;
+
+    if (_config.existsAs<double>(name))
+        cut.threshold = _config.getParameter<double>(name);
+
+    else if (_config.existsAs<bool>(name)
+            && _config.getParameter<bool>(name))
+        cut.threshold = 0;
+
+    else
+        return;
+
+    _cuts.push_back(cut);
+}
+
+template<typename T>
+    void bsm::CutEngine<T>::addGroup(const std::string &group,
+            const Precondition &precondition)
+{
+    if (static_cast<size_t>(MAX_GROUPS) == _groups.size())
+        throw cms::Exception("CutEngine")
+            << "too many " << _name << " cut groups: " << group;
+
+    Group new_group;
+    new_group.name = group;
+    new_group.precondition = precondition;
+    new_group.calls = 0;
+    new_group.timed_calls = 0;
+    new_group.time = 0;
+
+    _groups.push_back(new_group);
+}
+
+template<typename T>
+    void bsm::CutEngine<T>::add(const std::string &name,
+            const Predicate &predicate,
+            const std::string &group)
+{
+    int index = 0;
+    for(int groups = _groups.size(); groups > index; ++index)
+    {
+        if (group == _groups[index].name)
+            break;
+    }
+
+    if (_groups.size() == static_cast<size_t>(index))
+        throw cms::Exception("CutEngine")
+            << "unknown " << _name << " cut group " << group
+            << " of cut " << name;
+
+    const size_t cuts = _cuts.size();
+    add(name, predicate);
+
+    if (cuts != _cuts.size())
+        _cuts.back().group = index;
+}
+
+template<typename T>
+    void bsm::CutEngine<T>::addExternal(const std::string &name)
+{
+    _external.push_back(name);
+}
+
+template<typename T>
+    void bsm::CutEngine<T>::validate() const
+{
+    typedef std::vector<std::string> Names;
+
+    Names names = _config.getParameterNames();
+    for(Names::const_iterator name = names.begin();
+            names.end() != name;
+            ++name)
+    {
+        if (isOption(*name)
+                || _external.end() != std::find(_external.begin(),
+                    _external.end(), *name))
+            continue;
+
+        bool is_found = false;
+        for(typename Cuts::const_iterator cut = _cuts.begin();
+                _cuts.end() != cut;
+                ++cut)
+        {
+            if (*name == cut->name)
+            {
+                is_found = true;
+
+                break;
+            }
+        }
+
+        // Disabled boolean cuts are not compiled
+        //
+        if (!is_found
+                && !(_config.existsAs<bool>(*name)
+                    && !_config.getParameter<bool>(*name)))
+        {
+            throw cms::Exception("CutEngine")
+                << "unknown " << _name << " cut: " << *name;
+        }
+    }
+}
+
+template<typename T>
+    bool bsm::CutEngine<T>::operator()(T &object)
+{
+    if (_reorder_every
+            && _objects
+            && !(_objects % _reorder_every))
+        reorder();
+
+    ++_objects;
+
+    uint32_t is_group_done = 0;
+    for(typename Cuts::iterator cut = _cuts.begin();
+            _cuts.end() != cut;
+            ++cut)
+    {
+        bool is_passed = false;
+
+        // Time is measured only for every Nth call to keep overhead low
+        //
+        if (NO_GROUP != cut->group
+                && !(is_group_done & (1u << cut->group)))
+        {
+            Group &group = _groups[cut->group];
+            if (!(group.calls % _sample_every))
+            {
+                timespec start;
+                timespec stop;
+
+                clock_gettime(CLOCK_MONOTONIC, &start);
+                group.precondition(object);
+                clock_gettime(CLOCK_MONOTONIC, &stop);
+
+                group.time += elapsed(start, stop);
+                ++group.timed_calls;
+            }
+            else
+                group.precondition(object);
+
+            ++group.calls;
+            is_group_done |= 1u << cut->group;
+        }
+
+        if (!(cut->calls % _sample_every))
+        {
+            timespec start;
+            timespec stop;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            is_passed = cut->predicate(object, cut->threshold);
+            clock_gettime(CLOCK_MONOTONIC, &stop);
+
+            cut->time += elapsed(start, stop);
+            ++cut->timed_calls;
+        }
+        else
+            is_passed = cut->predicate(object, cut->threshold);
+
+        ++cut->calls;
+
+        if (!is_passed)
+        {
+            ++cut->rejected;
+
+            return false;
+        }
+    }
+
+    ++_passed;
+
+    return true;
+}
+
+template<typename T>
+    bool bsm::CutEngine<T>::evaluate(T &object) const
+{
+    uint32_t is_group_done = 0;
+    for(typename Cuts::const_iterator cut = _cuts.begin();
+            _cuts.end() != cut;
+            ++cut)
+    {
+        if (NO_GROUP != cut->group
+                && !(is_group_done & (1u << cut->group)))
+        {
+            _groups[cut->group].precondition(object);
+            is_group_done |= 1u << cut->group;
+        }
+
+        if (!cut->predicate(object, cut->threshold))
+            return false;
+    }
+
+    return true;
+}
+
+template<typename T>
+    std::string bsm::CutEngine<T>::summary() const
+{
+    using namespace std;
+
+    ostringstream out;
+    out << _name << " cuts: " << _passed << " out of " << _objects
+        << " objects passed" << endl;
+
+    out << setw(30) << left << "cut"
+        << setw(12) << right << "threshold"
+        << setw(14) << "calls"
+        << setw(12) << "rejection"
+        << setw(12) << "cost, ns" << endl;
+
+    for(typename Cuts::const_iterator cut = _cuts.begin();
+            _cuts.end() != cut;
+            ++cut)
+    {
+        out << setw(30) << left << cut->name
+            << setw(12) << right << cut->threshold
+            << setw(14) << cut->calls
+            << setw(12) << (cut->calls
+                    ? static_cast<double>(cut->rejected) / cut->calls
+                    : 0)
+            << setw(12) << cost(cut->timed_calls, cut->time)
+            << endl;
+    }
+
+    for(typename Groups::const_iterator group = _groups.begin();
+            _groups.end() != group;
+            ++group)
+    {
+        out << setw(30) << left << ("[" + group->name + "]")
+            << setw(12) << right << "-"
+            << setw(14) << group->calls
+            << setw(12) << "-"
+            << setw(12) << cost(group->timed_calls, group->time)
+            << endl;
+    }
+
+    return out.str();
+}
+
+
+
+// Privates
+//
+template<typename T>
+    bool bsm::CutEngine<T>::isCheaper(const Cut &left, const Cut &right)
+{
+    return left.rank < right.rank;
+}
+
+template<typename T>
+    bool bsm::CutEngine<T>::isOption(const std::string &name)
+{
+    return "reorder_every" == name
+        || "sample_every" == name;
+}
+
+template<typename T>
+    double bsm::CutEngine<T>::elapsed(const timespec &start,
+            const timespec &stop) const
+{
+    return 1e9 * (stop.tv_sec - start.tv_sec)
+        + (stop.tv_nsec - start.tv_nsec)
+        - _timer_overhead;
+}
+
+template<typename T>
+    double bsm::CutEngine<T>::cost(const uint64_t &timed_calls,
+            const double &time) const
+{
+    return timed_calls
+        ? std::max(time / timed_calls, 0.0)
+        : 0;
+}
+
+template<typename T>
+    double bsm::CutEngine<T>::rank(const Cut &cut) const
+{
+    // Cuts that never rejected anything are moved to the end
+    //
+    if (!cut.rejected
+            || !cut.timed_calls)
+        return std::numeric_limits<double>::max();
+
+    double cut_cost = cost(cut.timed_calls, cut.time);
+    if (NO_GROUP != cut.group)
+    {
+        const Group &group = _groups[cut.group];
+        cut_cost += cost(group.timed_calls, group.time);
+    }
+
+    return std::max(cut_cost, _min_cost)
+        / (static_cast<double>(cut.rejected) / cut.calls);
+}
+
+template<typename T>
+    void bsm::CutEngine<T>::reorder()
+{
+    for(typename Cuts::iterator cut = _cuts.begin();
+            _cuts.end() != cut;
+            ++cut)
+    {
+        cut->rank = rank(*cut);
+    }
+
+    std::stable_sort(_cuts.begin(), _cuts.end(), isCheaper);
+}
+
+#endif
@@ -0,0 +1,151 @@
+// Suppress events with already written (run, lumi, event) ID
+//
+// Created by Samvel Khalatyan, Mar 7, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_DUPLICATE_FILTER
+#define BSM_DUPLICATE_FILTER
+
+#include <stdint.h>
+
+#include <fstream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace bsm
+{
+    // Written IDs are kept exactly in a sorted array until exact_limit is
+    // reached, after that all IDs are moved into a Bloom filter sized for
+    // expected_events with given false positive rate. IDs are also kept
+    // exactly in the store: sorted runs of binary records on disk, each up
+    // to exact_limit IDs, and recent IDs in memory. Bloom filter answers
+    // most queries; its positives are confirmed in the store and only
+    // confirmed duplicates are rejected. Runs are merged into one if there
+    // are too many of them. Store files are removed with the filter.
+    //
+    // Filter is seeded with index files of previous outputs: text files
+    // with "run lumi event" line per event. Written IDs are appended to
+    // the index file if one is given
+    //
+    class DuplicateFilter
+    {
+        public:
+            DuplicateFilter(const edm::ParameterSet &);
+            ~DuplicateFilter();
+
+            bool isDuplicate(const uint32_t &run,
+                    const uint32_t &lumi,
+                    const uint64_t &event);
+
+            void insert(const uint32_t &run,
+                    const uint32_t &lumi,
+                    const uint64_t &event);
+
+            // Add ID written by an earlier job; it is not indexed
+            //
+            void seed(const uint32_t &run,
+                    const uint32_t &lumi,
+                    const uint64_t &event);
+
+        private:
+            struct Key
+            {
+                uint32_t run;
+                uint32_t lumi;
+                uint64_t event;
+
+                bool operator<(const Key &) const;
+                bool operator==(const Key &) const;
+            };
+
+            typedef std::vector<Key> Keys;
+            typedef std::set<Key> RecentKeys;
+            typedef std::vector<uint64_t> Bits;
+
+            static Key key(const uint32_t &run,
+                    const uint32_t &lumi,
+                    const uint64_t &event);
+
+            // Store record: run, lumi, event in 16 bytes
+            //
+            static void encode(const Key &, char *);
+            static void decode(const char *, Key &);
+
+            void seed(const std::string &filename);
+
+            void add(const Key &);
+            bool contains(const Key &);
+
+            // Merge recent keys into the sorted array
+            //
+            void merge();
+
+            // Move exact keys into Bloom filter
+            //
+            void useBloom();
+
+            void bloomAdd(const Key &);
+            bool bloomContains(const Key &) const;
+
+            struct Run
+            {
+                std::string filename;
+                int file;
+                uint64_t size;
+            };
+
+            typedef std::vector<Run> Runs;
+
+            // Write recent keys into a new store run
+            //
+            void flushRun();
+
+            // Write sorted keys into a new store run
+            //
+            void writeRun(const Keys &);
+
+            // Merge all store runs into one
+            //
+            void mergeRuns();
+
+            Run openRun();
+            void write(Run &, const Keys &);
+
+            // Read next block of keys at the offset; offset is advanced
+            //
+            static bool read(const Run &, uint64_t &offset, Keys &);
+            bool storeContains(const Key &) const;
+
+            uint32_t _exact_limit;
+            uint32_t _expected_events;
+            double _false_positive_rate;
+
+            Keys _keys;
+            RecentKeys _recent;
+
+            Bits _bloom;
+            uint64_t _bloom_bits;
+            uint32_t _bloom_hashes;
+            bool _is_bloom;
+
+            boost::shared_ptr<std::ofstream> _index;
+
+            std::string _store_filename;
+            Runs _runs;
+            uint32_t _store_files;
+
+            uint64_t _seeded;
+            uint64_t _duplicates;
+            uint64_t _false_positives;
+    };
+}
+
+#endif
@@ -6,8 +6,14 @@
 #ifndef BSM_ELECTRON_SELECTOR
 #define BSM_ELECTRON_SELECTOR
 
+#include <stdint.h>
+
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
+#include "bsm_input_maker/maker/interface/CutEngine.h"
+#include "bsm_input_maker/maker/interface/Kinematics.h"
 #include "bsm_input_maker/maker/interface/Selector.h"
 
 namespace pat
@@ -20,16 +26,35 @@ namespace bsm
     class ElectronSelector: public Selector
     {
         public:
-            ElectronSelector(const edm::InputTag &electron_tag);
-
-            typedef std::vector<const pat::Electron *> Electrons;
+            ElectronSelector(const edm::InputTag &electron_tag,
+                    const edm::ParameterSet &cuts);
+
+            // Selected electron and quantities evaluated by selector. The
+            // record is used to fill output instead of dereferencing the
+            // super cluster and track again
+            //
+            struct Candidate
+            {
+                const pat::Electron *electron;
+
+                float super_cluster_eta;
+                uint32_t inner_track_expected_hits;
+            };
+
+            typedef std::vector<Candidate> Electrons;
             
-            virtual bool init(const edm::Event *);
+            virtual bool init(const EventContext &);
 
             const Electrons &electron() const;
 
         private:
+            typedef CutEngine<Candidate> Cuts;
+
             Electrons _electron;
+
+            Kinematics _kinematics;
+
+            boost::shared_ptr<Cuts> _cuts;
     };
 }
 
@@ -0,0 +1,86 @@
+// Eta-phi grid index for dR searches
+//
+// Created by Samvel Khalatyan, Mar 12, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_ETA_PHI_GRID
+#define BSM_ETA_PHI_GRID
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace bsm
+{
+    // Objects are binned in eta-phi cells of the cone size: only objects in
+    // the 3x3 neighbouring cells are tested for each query instead of the
+    // full collection. Phi wraps around.
+    //
+    // Grid is rebuilt per event: clear, add objects, build and query. The
+    // storage keeps its capacity between events and queries write into the
+    // caller buffer, so no memory is allocated in the steady state
+    //
+    class EtaPhiGrid
+    {
+        public:
+            typedef std::vector<uint32_t> Indices;
+
+            // Objects on the cone boundary are found only if the cone is
+            // inclusive: jet cleaning uses dR <= cone, trigger matching
+            // uses dR < cone
+            //
+            EtaPhiGrid(const double &cone, const bool &is_inclusive);
+
+            double cone() const;
+
+            void clear();
+
+            // Add object with user index, e.g. position in the collection
+            //
+            void add(const uint32_t &index, const float &eta, const float &phi);
+
+            // Sort objects by cell: call after all objects are added
+            //
+            void build();
+
+            // Get sorted indices of the objects within the cone
+            //
+            void find(const float &eta, const float &phi, Indices &) const;
+
+        private:
+            struct Object
+            {
+                int64_t cell;
+                uint32_t index;
+
+                float eta;
+                float phi;
+
+                bool operator<(const Object &) const;
+            };
+
+            typedef std::vector<Object> Objects;
+
+            // Test objects in cells [first, last]
+            //
+            void scan(const int64_t &first_cell,
+                    const int64_t &last_cell,
+                    const float &eta,
+                    const float &phi,
+                    Indices &) const;
+
+            int64_t cell(const int &eta_cell, const int &phi_cell) const;
+            int etaCell(const float &eta) const;
+            int phiCell(const float &phi) const;
+
+            float _cone;
+            float _cone2;
+            bool _is_inclusive;
+            int _phi_cells;
+            float _phi_cell_size;
+
+            Objects _objects;
+    };
+}
+
+#endif
@@ -0,0 +1,154 @@
+// Per-event products shared by selectors and InputMaker
+//
+// Created by Samvel Khalatyan, Feb 27, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_EVENT_CONTEXT
+#define BSM_EVENT_CONTEXT
+
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+#include "DataFormats/Common/interface/Handle.h"
+#include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Utilities/interface/InputTag.h"
+
+namespace reco
+{
+    class Vertex;
+}
+
+namespace bsm
+{
+    // Context is created once per job and reset at the beginning of each
+    // event. Each product is extracted from the event at most once, on
+    // first access, and derived per-event quantities are evaluated lazily.
+    // Product holders are kept between events and reused for the same tag
+    //
+    class EventContext
+    {
+        public:
+            typedef std::vector<reco::Vertex> PrimaryVertices;
+            typedef std::vector<const reco::Vertex *> GoodPrimaryVertices;
+
+            EventContext(const edm::InputTag &primary_vertex_tag,
+                    const edm::InputTag &rho_tag);
+
+            // Forget products of the previous event
+            //
+            void reset(const edm::Event &);
+
+            const edm::Event &event() const;
+
+            // Get product from the event. Return 0 if product is not found
+            // or tag is empty
+            //
+            template<typename T>
+                const T *product(const edm::InputTag &) const;
+
+            const edm::InputTag &primaryVertexTag() const;
+            const edm::InputTag &rhoTag() const;
+
+            // Return 0 if primary vertices are not available
+            //
+            const PrimaryVertices *primaryVertices() const;
+
+            // Vertices that pass selector::isGoodPrimaryVertex
+            //
+            const GoodPrimaryVertices &goodPrimaryVertices() const;
+
+            // Number of primary vertices in the collection
+            //
+            uint32_t npv() const;
+
+            // Return 0 if rho is not available
+            //
+            const double *rho() const;
+
+        private:
+            struct Holder
+            {
+                virtual ~Holder()
+                {
+                }
+            };
+
+            template<typename T>
+                struct Product: public Holder
+                {
+                    edm::Handle<T> handle;
+                };
+
+            struct Entry
+            {
+                Entry(const edm::InputTag &, Holder *);
+
+                edm::InputTag tag;
+                boost::shared_ptr<Holder> holder;
+
+                bool is_loaded;
+            };
+
+            typedef std::vector<Entry> Entries;
+
+            const edm::Event *_event;
+
+            edm::InputTag _primary_vertex_tag;
+            edm::InputTag _rho_tag;
+
+            mutable Entries _products;
+
+            mutable bool _good_primary_vertices_done;
+            mutable GoodPrimaryVertices _good_primary_vertices;
+    };
+}
+
+template<typename T>
+    const T *bsm::EventContext::product(const edm::InputTag &tag) const
+{
+    if (tag.label().empty())
+        return 0;
+
+    // There are only a few products per event: linear search is enough
+    //
+    Product<T> *product = 0;
+    for(typename Entries::iterator entry = _products.begin();
+            _products.end() != entry;
+            ++entry)
+    {
+        if (!(tag == entry->tag))
+            continue;
+
+        product = dynamic_cast<Product<T> *>(entry->holder.get());
+        if (!product)
+            continue;
+
+        if (!entry->is_loaded)
+        {
+            _event->getByLabel(tag, product->handle);
+            entry->is_loaded = true;
+        }
+
+        break;
+    }
+
+    // Holders are only created until every product was used once
+    //
+    if (!product)
+    {
+        product = new Product<T>();
+        _products.push_back(Entry(tag, product));
+
+        _event->getByLabel(tag, product->handle);
+    }
+
+    return product->handle.isValid()
+        ? product->handle.product()
+        : 0;
+}
+
+#endif
@@ -0,0 +1,96 @@
+// Reuse event message memory between events
+//
+// Created by Samvel Khalatyan, Mar 15, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_EVENT_RECYCLER
+#define BSM_EVENT_RECYCLER
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace google
+{
+    namespace protobuf
+    {
+        class Message;
+        class UnknownFieldSet;
+    }
+}
+
+namespace bsm
+{
+    class Event;
+
+    // Cleared message keeps allocated repeated sub-messages, strings and
+    // the unknown fields list, and add_*() hands them out again: once the
+    // pool has grown to the largest event, sub-messages are not allocated.
+    // Length-delimited unknown fields are freed by Clear() in protobuf 2.3:
+    // trigger filters hand their unknown fields to the recycler before the
+    // event is cleared and addString() gives them to the next filters.
+    //
+    // Retained memory is sampled every N events (reflection walk over the
+    // whole pool). New high-water mark after warm-up means the pool still
+    // grows; allocations that are freed within the event are not seen.
+    // Pool above the limit is released by replacing the message
+    //
+    class EventRecycler
+    {
+        public:
+            EventRecycler(const edm::ParameterSet &);
+
+            // Clear event for reuse; message is replaced if trimmed
+            //
+            void recycle(boost::shared_ptr<Event> &);
+
+            // Add length-delimited unknown field, see ExtraFields.h. String
+            // of the earlier event is reused if message has no unknown
+            // fields yet
+            //
+            void addString(google::protobuf::Message *,
+                    const int &field,
+                    const std::string &value);
+
+            uint64_t events() const;
+            uint64_t samples() const;
+
+            // Number of samples with new retained memory high-water mark
+            //
+            uint64_t growths() const;
+            uint64_t trims() const;
+
+            uint64_t highWater() const;
+
+        private:
+            typedef boost::shared_ptr<google::protobuf::UnknownFieldSet>
+                UnknownFields;
+
+            void keep(Event &);
+
+            uint32_t _sample_every;
+            uint64_t _max_bytes;
+
+            uint64_t _events;
+            uint64_t _samples;
+            uint64_t _growths;
+            uint64_t _trims;
+            uint64_t _high_water;
+
+            // Unknown fields with one string are kept in front, empty sets
+            // that were swapped for them follow
+            //
+            std::vector<UnknownFields> _unknown_fields;
+            uint32_t _kept_unknown_fields;
+    };
+}
+
+#endif
@@ -0,0 +1,88 @@
+// Output fields written ahead of the bsm_input schema
+//
+// Created by Samvel Khalatyan, Mar 2, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_EXTRA_FIELDS
+#define BSM_EXTRA_FIELDS
+
+namespace bsm
+{
+    // Fields are stored as protobuf unknown fields with the numbers below,
+    // see utility::addVarint. Readers that declare the same numbers in the
+    // schema get regular fields, older readers skip them. Numbers start
+    // from 1000 to stay clear of the schema fields
+    //
+    // Gen-particle index is the position in the event gen_particle trees
+    // visited depth-first: root, then its children
+    //
+    // Ttbar hypothesis is jet indices in the event jets packed in bytes:
+    // leptonic b, hadronic b, first and second W quarks; the fifth byte is
+    // neutrino pz solution. Chi2 of the same hypothesis is in the same
+    // position, hypotheses are in the chi2 order
+    //
+    namespace extra_field
+    {
+        // bsm::Input
+        //
+        enum Input
+        {
+            INPUT_JET_VARIATION = 1000,     // repeated string
+            INPUT_CHANNEL = 1001            // repeated string
+        };
+
+        // bsm::Event
+        //
+        enum Event
+        {
+            EVENT_JET_VARIATIONS = 1000,    // uint32 bitmask
+            EVENT_CHANNELS = 1001,          // uint32 bitmask
+            EVENT_NPV = 1002,               // uint32, all vertices
+            EVENT_GOOD_NPV = 1003,          // uint32, good vertices
+            EVENT_TTBAR_HYPOTHESES = 1004,  // repeated uint64, see below
+            EVENT_TTBAR_CHI2 = 1005         // repeated float
+        };
+
+        // bsm::Electron
+        //
+        enum Electron
+        {
+            ELECTRON_TRIGGER_OBJECTS = 1000,    // repeated uint32
+            ELECTRON_TRIGGER_FILTERS = 1001     // repeated uint32
+        };
+
+        // bsm::Muon
+        //
+        enum Muon
+        {
+            MUON_TRIGGER_OBJECTS = 1000,        // repeated uint32
+            MUON_TRIGGER_FILTERS = 1001         // repeated uint32
+        };
+
+        // bsm::TriggerFilter
+        //
+        enum TriggerFilter
+        {
+            TRIGGER_FILTER_KEYS = 1000      // bytes, see TriggerFilterKeys.h
+        };
+
+        // bsm::PrimaryVertex
+        //
+        enum PrimaryVertex
+        {
+            PRIMARY_VERTEX_GOOD = 1000      // bool, isGoodPrimaryVertex
+        };
+
+        // bsm::Jet
+        //
+        enum Jet
+        {
+            JET_VARIATIONS = 1000,          // uint32 bitmask
+            JET_TRIGGER_OBJECTS = 1001,     // repeated uint32
+            JET_TRIGGER_FILTERS = 1002,     // repeated uint32
+            JET_GEN_PARTON = 1003           // uint32, gen-particle index
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,90 @@
+// Select roots of the stored gen-particle trees
+//
+// Created by Samvel Khalatyan, Mar 17, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_GEN_PARTICLE_FILTER
+#define BSM_GEN_PARTICLE_FILTER
+
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "DataFormats/HepMCCandidate/interface/GenParticleFwd.h"
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace bsm
+{
+    // Each rule defines roots by |pdgId| and status, statuses of the stored
+    // children and depth of the tree. Rules are evaluated with lookup
+    // tables: bit per rule for every |pdgId| and status, so the scan costs
+    // two loads per particle for any number of rules. Particle belongs to
+    // the first rule that matches.
+    //
+    // Single rule with one |pdgId| and one status, e.g. status 3 top
+    // quarks, is scanned with a specialized comparison. Scan stops once
+    // every rule found its maximum number of roots
+    //
+    class GenParticleFilter
+    {
+        public:
+            struct Root
+            {
+                const reco::GenParticle *particle;
+                uint32_t rule;
+            };
+
+            typedef std::vector<Root> Roots;
+
+            GenParticleFilter(const std::vector<edm::ParameterSet> &rules);
+
+            // Roots in the collection order
+            //
+            const Roots &roots(const reco::GenParticleCollection &);
+
+            uint32_t depth(const uint32_t &rule) const;
+            bool isChild(const uint32_t &rule, const int &status) const;
+
+            // Mask of the rules that match |pdgId| and status
+            //
+            uint32_t rules(const int &pdg_id, const int &status) const;
+
+        private:
+            template<typename Match>
+                void scan(const reco::GenParticleCollection &,
+                        const Match &);
+
+            typedef std::vector<uint32_t> RuleMasks;
+            typedef std::pair<uint32_t, uint32_t> PdgIdRules;
+
+            // Table is indexed by |pdgId| for fundamental particles, larger
+            // ids are kept sorted
+            //
+            RuleMasks _pdg_id_rules;
+            std::vector<PdgIdRules> _large_pdg_id_rules;
+
+            RuleMasks _status_rules;
+            RuleMasks _child_status_rules;
+
+            std::vector<uint32_t> _depth;
+            std::vector<uint32_t> _max_roots;
+            std::vector<uint32_t> _found;
+
+            // Rules without roots limit keep the scan going
+            //
+            uint32_t _all_rules;
+
+            bool _is_single;
+            int _single_pdg_id;
+            int _single_status;
+
+            Roots _roots;
+    };
+}
+
+#endif
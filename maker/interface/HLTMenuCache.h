@@ -0,0 +1,62 @@
+// Parsed HLT menus cached on disk between jobs
+//
+// Created by Samvel Khalatyan, Mar 22, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_HLT_MENU_CACHE
+#define BSM_HLT_MENU_CACHE
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace bsm
+{
+    // Menu is the selected paths with names and versions as stored in the
+    // output, and path filters that match the filter pattern in the module
+    // order. Hashes depend on the build and are not cached: the loader
+    // recomputes them from the names. Menus are stored one per file in the cache directory:
+    // file name is made of the key hash and the key is kept in the file to
+    // resolve collisions. Key should include HLT table name, process and
+    // patterns. Files are written into temporary file and moved in place:
+    // concurrent jobs never read partially written menu
+    //
+    class HLTMenuCache
+    {
+        public:
+            struct Filter
+            {
+                std::string label;
+                std::string name;
+            };
+
+            typedef std::vector<Filter> Filters;
+
+            struct Path
+            {
+                uint32_t id;
+                std::string full_name;
+                std::string name;
+                uint32_t version;
+
+                Filters filters;
+            };
+
+            typedef std::vector<Path> Menu;
+
+            HLTMenuCache(const std::string &directory);
+
+            // Return false if menu is not cached or file can not be read
+            //
+            bool load(const std::string &key, Menu &) const;
+            bool save(const std::string &key, const Menu &) const;
+
+        private:
+            std::string filename(const std::string &key) const;
+
+            std::string _directory;
+    };
+}
+
+#endif
@@ -0,0 +1,97 @@
+// Control distributions filled during production
+//
+// Created by Samvel Khalatyan, Mar 9, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_HISTOGRAMS
+#define BSM_HISTOGRAMS
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace bsm
+{
+    // Fixed binning histograms are accumulated in plain arrays and
+    // converted into ROOT histograms only at the end of the job. Each
+    // histogram is defined by name, variable, stage, bins, min and max
+    //
+    class Histograms
+    {
+        public:
+            enum Stage
+            {
+                PRE = 0,    // certified unique events, input collections
+                POST,       // written events, selected objects
+                STAGES
+            };
+
+            enum Variable
+            {
+                JET_PT = 0,
+                JET_ETA,
+                ELECTRON_PT,
+                ELECTRON_ETA,
+                ELECTRON_ISOLATION,
+                MUON_PT,
+                MUON_ETA,
+                MUON_ISOLATION,
+                NPV,
+                MET,
+                PILEUP,
+                VARIABLES
+            };
+
+            Histograms(const std::vector<edm::ParameterSet> &);
+
+            // Variables are evaluated only if any histogram uses them
+            //
+            bool isUsed(const Stage &, const Variable &) const;
+
+            // Any histogram is filled at the stage
+            //
+            bool isUsed(const Stage &) const;
+
+            void fill(const Stage &, const Variable &, const double &value);
+
+            // Write histograms with TFileService into pre and post folders
+            //
+            void write() const;
+
+        private:
+            struct Histogram
+            {
+                std::string name;
+                Stage stage;
+                Variable variable;
+
+                double min;
+                double max;
+                double scale;
+
+                // Underflow, bins, overflow
+                //
+                std::vector<double> bins;
+                uint64_t entries;
+
+                void fill(const double &);
+            };
+
+            typedef std::vector<Histogram> Collection;
+            typedef std::vector<uint32_t> Indices;
+
+            Collection _histograms;
+
+            // Histograms indices per stage and variable
+            //
+            Indices _used[STAGES][VARIABLES];
+    };
+}
+
+#endif
@@ -8,6 +8,7 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 #include <boost/shared_ptr.hpp>
 
@@ -17,16 +18,20 @@
 
 #include "bsm_input_maker/bsm_input/interface/bsm_input_fwd.h"
 #include "bsm_input_maker/bsm_input/interface/Input.pb.h"
+#include "bsm_input_maker/bsm_input/interface/Physics.pb.h"
 #include "bsm_input_maker/bsm_input/interface/Writer.h"
+#include "bsm_input_maker/maker/interface/Channel.h"
+#include "bsm_input_maker/maker/interface/ElectronSelector.h"
+#include "bsm_input_maker/maker/interface/EtaPhiGrid.h"
+#include "bsm_input_maker/maker/interface/Histograms.h"
+#include "bsm_input_maker/maker/interface/JetSelector.h"
+#include "bsm_input_maker/maker/interface/MuonSelector.h"
+#include "bsm_input_maker/maker/interface/TriggerFilterKeys.h"
+#include "bsm_input_maker/maker/interface/TtbarHypotheses.h"
 
 class HLTConfigProvider;
 class PFJetIDSelectionFunctor;
-
-namespace pat
-{
-    class Electron;
-    class Muon;
-}
+class PileupSummaryInfo;
 
 namespace reco
 {
@@ -35,9 +40,15 @@ namespace reco
 
 namespace bsm
 {
-    class ElectronSelector;
-    class JetSelector;
-    class MuonSelector;
+    class ByteBudget;
+    class Checkpoint;
+    class DuplicateFilter;
+    class EventContext;
+    class EventRecycler;
+    class GenParticleFilter;
+    class HLTMenuCache;
+    class LumiMask;
+    class LumiSummary;
 
     class InputMaker: public edm::EDAnalyzer,
         public bsm::WriterDelegate
@@ -54,19 +65,71 @@ namespace bsm
             typedef ::google::protobuf::RepeatedPtrField<bsm::TriggerItem>
                 TriggerItems;
 
-            enum
+            enum PrimaryVertexStorage
+            {
+                PV_ALL = 0,
+                PV_GOOD,
+                PV_FIRST
+            };
+
+            enum MatchObject
             {
-                TOP = 6
+                MATCH_ELECTRON = 0,
+                MATCH_MUON,
+                MATCH_JET,
+                MATCH_OBJECTS
+            };
+
+            // Trigger objects of the filters that match patterns are
+            // matched to the selected objects of the type
+            //
+            struct TriggerMatching
+            {
+                std::vector<boost::regex> filters;
+                boost::shared_ptr<EtaPhiGrid> grid;
+
+                // Event filters indices that match patterns
+                //
+                std::vector<uint32_t> event_filters;
             };
 
             void setInputType(std::string);
 
+            // Open writers of the main and channel streams; the current
+            // part is opened if checkpoints are used
+            //
+            void openWriters();
+            void closeWriters();
+
+            // At least one stream is open
+            //
+            bool isWriterOpen() const;
+            void setPrimaryVertexStorage(std::string);
+
             virtual void beginRun(const edm::Run &, const edm::EventSetup &);
+            virtual void beginLuminosityBlock(const edm::LuminosityBlock &,
+                    const edm::EventSetup &);
             virtual void analyze(const edm::Event &, const edm::EventSetup &);
+            virtual void endJob();
 
             void initHLT(const edm::Run &, const edm::EventSetup &);
 
-            bool triggers(const edm::Event &, const edm::EventSetup &);
+            // Cached menu key: table, process and patterns
+            //
+            std::string hltMenuKey() const;
+            bool loadHLTMenu(const std::string &key);
+            void saveHLTMenu(const std::string &key) const;
+
+            // Index of the menu filter with module label, filter is added
+            // if it is not known yet
+            //
+            uint32_t hltFilter(const std::string &label);
+
+            // Mask of trigger matching objects that use the filter
+            //
+            uint32_t triggerMatching(const std::string &filter_name) const;
+
+            bool triggers(const EventContext &);
 
             bool isTriggerItemInCollection(const TriggerItems &collection,
                     const std::size_t &hash);
@@ -85,26 +148,71 @@ namespace bsm
 
             void addBTags(Jet *, const pat::Jet *);
 
-            void pileUp(const edm::Event &);
-            void genParticle(const edm::Event &);
+            void pileUp(const EventContext &);
+            void countPileUp(const EventContext &);
+
+            // Return 0 if pileup is not available
+            //
+            const PileupSummaryInfo *inTimePileUp(const EventContext &);
+
+            void fillHistograms(const Histograms::Stage &,
+                    const EventContext &);
+            void genParticle(const EventContext &);
             void products(bsm::GenParticle *,
                     const reco::Candidate &,
+                    const uint32_t &rule,
                     const uint32_t &level = 0);
 
-            bool electron(const edm::Event &);
-            bool muon(const edm::Event &);
-            bool jet(const edm::Event &);
+            // Index of the particle in the stored gen-particle trees, -1 if
+            // particle is not stored
+            //
+            int genParticleIndex(const reco::Candidate &) const;
+
+            // Run selectors and evaluate channels. Return mask of passed
+            // channels and mask of jet variations that pass any channel
+            //
+            uint32_t select(const EventContext &, uint32_t &jet_variations);
+
+            void electron();
+            void muon();
+            void jet(const uint32_t &jet_variations);
+
+            // Best ttbar hypotheses of the stored nominal jets, leading
+            // lepton and MET
+            //
+            void ttbarHypotheses(const EventContext &);
+
+            void write(const uint32_t &channels);
+
+            // Store indices of the matched trigger objects and filters in
+            // the selected objects
+            //
+            void matchTriggers();
+            void matchTrigger(const MatchObject &);
+
+            void primaryVertex(const EventContext &);
+            void met(const EventContext &);
 
-            void primaryVertex(const edm::Event &);
-            void met(const edm::Event &);
+            void fill(bsm::Electron *, const ElectronSelector::Candidate &);
+            void fill(bsm::Muon *, const MuonSelector::Candidate &);
+            void fill(bsm::Jet *, const JetSelector::Candidate &);
 
-            void fill(bsm::Electron *, const pat::Electron *);
-            void fill(bsm::Muon *, const pat::Muon *);
-            void fill(bsm::Jet *, const pat::Jet *);
+            // Electron ID names are built once, not in every electron
+            //
+            typedef std::pair<bsm::Electron::ElectronIDName, std::string>
+                ElectronID;
+
+            std::vector<ElectronID> _electron_ids;
 
             edm::InputTag _pileup_tag;
             edm::InputTag _gen_particle_tag;
-            uint32_t _gen_particle_depth_level;
+            boost::shared_ptr<GenParticleFilter> _gen_particle_filter;
+
+            // Stored gen-particles in the index order: jets refer to the
+            // partons by index if enabled
+            //
+            std::vector<const reco::Candidate *> _gen_particle_table;
+            bool _gen_parton_by_index;
 
             edm::InputTag _jet_tag;
             edm::InputTag _rho_tag;
@@ -115,6 +223,9 @@ namespace bsm
             edm::InputTag _primary_vertex_tag;
             edm::InputTag _missing_energy_tag;
 
+            PrimaryVertexStorage _primary_vertex_storage;
+            uint32_t _primary_vertex_limit;
+
             edm::InputTag _trigger_results_tag;
             edm::InputTag _trigger_event_tag;
 
@@ -124,9 +235,68 @@ namespace bsm
 
             Input::Type _input_type;
 
+            // Certification is evaluated once per luminosity block
+            //
+            boost::shared_ptr<LumiMask> _lumi_mask;
+            bool _is_lumi_certified;
+
+            uint32_t _rejected_lumis;
+            uint32_t _rejected_events;
+
+            // Events with already written ID are dropped before selection
+            //
+            boost::shared_ptr<DuplicateFilter> _duplicate_filter;
+
+            // Written events are journaled for the restart of the job
+            //
+            boost::shared_ptr<Checkpoint> _checkpoint;
+
+            // Events are counted per lumi for every job, summary is written
+            // only if filename is given
+            //
+            boost::shared_ptr<LumiSummary> _lumi_summary;
+            std::string _lumi_summary_filename;
+
+            boost::shared_ptr<Histograms> _histograms;
+
+            typedef std::vector<Channel> Channels;
+            typedef std::vector<boost::shared_ptr<Writer> > Writers;
+
+            Channels _channels;
+
+            // Channels with own output stream, 0 for the main stream
+            //
+            Writers _channel_writers;
+
+            // Channels that are written into the main stream
+            //
+            uint32_t _main_channels;
+
+            std::string _output_filename;
+
+            // Main stream is not opened if all channels have own streams
+            //
             boost::shared_ptr<Writer> _writer;
+
+            // All opened streams: main and channels
+            //
+            Writers _writers;
             boost::shared_ptr<Event> _event;
 
+            // Event message is cleared once per event and its sub-messages
+            // are reused
+            //
+            boost::shared_ptr<EventRecycler> _event_recycler;
+
+            // Products of the event; holders are reused between events
+            //
+            boost::shared_ptr<EventContext> _event_context;
+
+            // Serialized bytes per field of the sampled written events
+            //
+            boost::shared_ptr<ByteBudget> _byte_budget;
+            std::string _byte_budget_filename;
+
             boost::shared_ptr<HLTConfigProvider> _hlt_config;
 
             struct TriggerItem
@@ -139,17 +309,81 @@ namespace bsm
             struct Trigger: public TriggerItem
             {
                 uint32_t version;
+
+                // Saved filters of the path in the modules order
+                //
+                std::vector<uint32_t> filters;
+            };
+
+            // Menu module that is saved if it matches filter pattern. Bit
+            // is set for every trigger matching object type with the filter
+            //
+            struct HLTFilter: public TriggerItem
+            {
+                bool is_saved;
+                uint32_t matching;
             };
 
             // CMSSW ID/key <-> Trigger object [Menu]
             //
             typedef std::map<uint32_t, Trigger> Triggers;
+            typedef std::map<std::string, uint32_t> HLTFilterIndices;
 
             Triggers _hlts;
 
+            // Menu filters are evaluated once per menu and module label
+            //
+            std::vector<HLTFilter> _hlt_filters;
+            HLTFilterIndices _hlt_filter_indices;
+
+            // Parsed menus are reused between jobs if cache is enabled
+            //
+            boost::shared_ptr<HLTMenuCache> _hlt_menu_cache;
+
+            // Per-event trigger scratch: CMSSW trigger object key -> pb key
+            // and filter pb keys. Storage is kept between events
+            //
+            std::vector<uint32_t> _trigger_object_map;
+            std::vector<uint32_t> _trigger_filter_keys;
+
+            // Per-event producer name in lower case
+            //
+            std::string _producer_name;
+
+            // Per-event trigger matching scratch: (trigger object, filter)
+            // pairs, selected objects and matches of one object
+            //
+            typedef std::pair<uint32_t, uint32_t> ObjectFilter;
+
+            std::vector<ObjectFilter> _match_object_filters;
+            std::vector<google::protobuf::Message *> _match_pb_objects;
+            std::vector<const bsm::LorentzVector *> _match_p4s;
+            EtaPhiGrid::Indices _matched_objects;
+            EtaPhiGrid::Indices _matched_filters;
+
+            // Per-event menu filter -> pb key
+            //
+            std::vector<uint32_t> _trigger_filter_map;
+
+            // Filter keys are stored in the repeated field if disabled
+            //
+            boost::shared_ptr<TriggerFilterKeys> _trigger_filter_encoder;
+
+            TriggerMatching _trigger_matching[MATCH_OBJECTS];
+
             boost::shared_ptr<ElectronSelector> _electron_selector;
             boost::shared_ptr<MuonSelector> _muon_selector;
             boost::shared_ptr<JetSelector> _jet_selector;
+
+            // Hypotheses are not evaluated if disabled. Inputs and results
+            // are kept between events
+            //
+            boost::shared_ptr<TtbarHypotheses> _ttbar_hypotheses;
+
+            TtbarHypotheses::LorentzVectors _ttbar_jets;
+            TtbarHypotheses::Floats _ttbar_btags;
+            std::vector<uint8_t> _ttbar_jet_index;
+            TtbarHypotheses::Hypotheses _ttbar_result;
     };
 }
 
@@ -0,0 +1,55 @@
+// Binary pre-compiled Jet Energy Correction parameters
+//
+// Created by Samvel Khalatyan, Feb 24, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_JEC_CACHE
+#define BSM_JEC_CACHE
+
+#include <stdint.h>
+
+#include <string>
+
+class JetCorrectorParameters;
+
+namespace bsm
+{
+    namespace jec
+    {
+        // Binary format version: increase on any layout change
+        //
+        enum
+        {
+            VERSION = 1
+        };
+
+        // 64-bit FNV-1a checksum of the file content. Binary cache is valid
+        // only for the text file with the same checksum
+        //
+        uint64_t checksum(const std::string &filename);
+
+        // Binary cache location for the text file
+        //
+        std::string binaryFilename(const std::string &text_filename);
+
+        // Parse text file and write its binary representation. Return false
+        // if the binary file could not be written
+        //
+        bool compile(const std::string &text_filename,
+                const std::string &binary_filename);
+
+        // Memory-map binary file and load parameters. Return false if the
+        // file is missing, has different version or checksum
+        //
+        bool load(const std::string &binary_filename,
+                const uint64_t &checksum,
+                JetCorrectorParameters &);
+
+        // Load binary cache of the text file if one is available and valid,
+        // otherwise parse the text file
+        //
+        JetCorrectorParameters load(const std::string &text_filename);
+    }
+}
+
+#endif
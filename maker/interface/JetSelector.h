@@ -11,11 +11,16 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include "DataFormats/Math/interface/LorentzVector.h"
+
+#include "bsm_input_maker/maker/interface/CutEngine.h"
 #include "bsm_input_maker/maker/interface/Selector.h"
 #include "bsm_input_maker/maker/interface/ElectronSelector.h"
+#include "bsm_input_maker/maker/interface/EtaPhiGrid.h"
+#include "bsm_input_maker/maker/interface/Kinematics.h"
 #include "bsm_input_maker/maker/interface/MuonSelector.h"
 
-class FactorizedJetCorrector;
+class JetCorrectionUncertainty;
 
 namespace pat
 {
@@ -24,36 +29,167 @@ namespace pat
 
 namespace bsm
 {
+    class BatchJetCorrector;
+
     class JetSelector: public Selector
     {
         public:
             typedef std::vector<std::string> JECFiles;
+            typedef math::XYZTLorentzVector LorentzVector;
+
+            // Selected jet and kinematics evaluated by selector
+            //
+            struct Candidate
+            {
+                const pat::Jet *jet;
+
+                // PAT uncorrected p4
+                //
+                LorentzVector uncorrected_p4;
+
+                // Uncorrected p4 with leptons removed and JEC applied
+                //
+                LorentzVector corrected_p4;
+
+                float correction;
+                float area;
+
+                // JER smearing factor included in corrected p4: 1 if jet is
+                // not smeared
+                //
+                float jer;
+
+                // Bit per variation the jet passes: bit 0 is nominal
+                //
+                uint32_t variations;
+            };
 
-            typedef std::vector<const pat::Jet *> Jets;
+            typedef std::vector<Candidate> Jets;
+            typedef std::vector<std::string> Variations;
+            typedef std::vector<uint32_t> Counts;
             typedef ElectronSelector::Electrons Electrons;
             typedef MuonSelector::Muons Muons;
             
             JetSelector(const edm::InputTag &jet_tag,
-                    const edm::InputTag &primary_vertex_tag,
-                    const edm::InputTag &rho_tag,
-                    const JECFiles &);
+                    const edm::ParameterSet &cuts,
+                    const JECFiles &,
+                    const double &lepton_cone = 0.5);
 
-            virtual bool init(const edm::Event *,
+            virtual bool init(const EventContext &,
                     const Electrons &,
                     const Muons &);
 
+            // Jets that pass nominal or any of the variations
+            //
             const Jets &jet() const;
 
-            const edm::InputTag &primaryVertexTag() const;
-            const edm::InputTag &rhoTag() const;
+            double leptonCone() const;
+
+            // Use interpolation grid for JEC levels that depend on jet pt
+            // only. See BatchJetCorrector::useGrid
+            //
+            void useJECGrid(const uint32_t &points, const float &tolerance);
+
+            // Evaluate JES and JER variations in the same pass. Each JES
+            // source and JER add up and down variations applied to the
+            // cleaned, corrected and smeared jet, and the same cuts are
+            // evaluated. Nominal jets are smeared with central JER factors
+            //
+            void useSystematics(const edm::ParameterSet &);
+
+            // Variations names: nominal is the first
+            //
+            const Variations &variations() const;
+
+            // Number of selected jets per variation
+            //
+            const Counts &selected() const;
 
         private:
+            typedef CutEngine<Candidate> Cuts;
+            typedef std::vector<float> Floats;
+
+            struct Variation
+            {
+                enum Type
+                {
+                    JES = 0,
+                    JER
+                };
+
+                Type type;
+                bool is_up;
+
+                boost::shared_ptr<JetCorrectionUncertainty> uncertainty;
+            };
+
+            typedef std::vector<Variation> VariationDefinitions;
+
+            // Scale factor of the corrected jet p4 in variation
+            //
+            float scale(const Variation &, const Candidate &) const;
+
+            // Ratio of smeared to corrected jet pt with the JER factors of
+            // |eta| bins; 1 if jet is not matched to generator jet
+            //
+            float smear(const pat::Jet &,
+                    const float &eta,
+                    const float &pt,
+                    const Floats &factors) const;
+
+            typedef std::vector<LorentzVector> LorentzVectors;
+
+            // Subtract all leptons within the cone from the jets clean p4.
+            // The kernel scans all jets per lepton; eta-phi grid over jets
+            // is used only for events with many leptons and jets, see
+            // bin/bench_eta_phi_grid.cc for the crossover
+            //
+            void clean();
+            void cleanWithGrid();
+
             Jets _jet;
 
-            edm::InputTag _primary_vertex_tag;
-            edm::InputTag _rho_tag;
+            // Per-event scratch arrays of the cleaning kernel: jets and
+            // leptons directions are packed contiguously once per event
+            //
+            Floats _jet_eta;
+            Floats _jet_phi;
+            LorentzVectors _jet_raw_p4;
+            LorentzVectors _jet_clean_p4;
+            Floats _jet_area;
+
+            Floats _lepton_eta;
+            Floats _lepton_phi;
+            std::vector<const LorentzVector *> _lepton_p4;
+
+            Floats _dr2;
+
+            boost::shared_ptr<EtaPhiGrid> _jet_grid;
+            EtaPhiGrid::Indices _grid_jets;
+
+            // Cleaned jets kinematics and JEC factors
+            //
+            Floats _clean_eta;
+            Floats _clean_pt;
+            Floats _clean_e;
+            Floats _jec_factor;
+            Floats _jer_factor;
+
+            float _lepton_cone2;
+
+            boost::shared_ptr<BatchJetCorrector> _jec;
+            Kinematics _kinematics;
+
+            boost::shared_ptr<Cuts> _cuts;
+
+            Variations _variation_names;
+            VariationDefinitions _variations;
+            Counts _selected;
 
-            boost::shared_ptr<FactorizedJetCorrector> _jec;
+            Floats _jer_eta;
+            Floats _jer_central;
+            Floats _jer_up;
+            Floats _jer_down;
     };
 }
 
@@ -0,0 +1,73 @@
+// Per-event structure of arrays with objects kinematics
+//
+// Created by Samvel Khalatyan, Mar 14, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_KINEMATICS
+#define BSM_KINEMATICS
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace bsm
+{
+    // Kinematics of the collection is copied once per event into contiguous
+    // float arrays. Pt and eta cuts are evaluated by vectorized kernel over
+    // the arrays, and only indices of the passed objects are used to access
+    // the full objects. Arrays keep capacity between events
+    //
+    class Kinematics
+    {
+        public:
+            typedef std::vector<float> Floats;
+            typedef std::vector<uint32_t> Indices;
+
+            // Thresholds are taken from pt and eta cuts if these are set
+            //
+            Kinematics(const edm::ParameterSet &cuts);
+
+            void clear();
+
+            void add(const float &pt, const float &eta,
+                    const float &phi, const float &energy);
+
+            std::size_t size() const;
+
+            const Floats &pt() const;
+            const Floats &eta() const;
+            const Floats &phi() const;
+            const Floats &energy() const;
+
+            // Apply kinematic cuts and return indices of passed objects
+            //
+            const Indices &select();
+
+            // Object passed kinematic cuts in the last select
+            //
+            bool isSelected(const std::size_t &index) const;
+
+            // Scalar test of kinematics that are not in the arrays
+            //
+            bool isPassed(const float &pt, const float &eta) const;
+
+        private:
+            float _min_pt;
+            float _max_abs_eta;
+
+            Floats _pt;
+            Floats _eta;
+            Floats _phi;
+            Floats _energy;
+
+            std::vector<uint32_t> _pass;
+            Indices _selected;
+    };
+}
+
+#endif
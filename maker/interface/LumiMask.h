@@ -0,0 +1,43 @@
+// Certified luminosity sections mask
+//
+// Created by Samvel Khalatyan, Mar 6, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_LUMI_MASK
+#define BSM_LUMI_MASK
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bsm
+{
+    // Mask is loaded from the certification JSON file:
+    //
+    //  {"run": [[first_lumi, last_lumi], ...], ...}
+    //
+    // Intervals are sorted and merged per run: lookup is O(log n)
+    //
+    class LumiMask
+    {
+        public:
+            LumiMask(const std::string &filename);
+
+            bool accept(const uint32_t &run, const uint32_t &lumi) const;
+
+            uint32_t runs() const;
+            uint32_t intervals() const;
+
+        private:
+            typedef std::pair<uint32_t, uint32_t> Interval;
+            typedef std::vector<Interval> Intervals;
+            typedef std::map<uint32_t, Intervals> Runs;
+
+            Runs _runs;
+    };
+}
+
+#endif
@@ -0,0 +1,89 @@
+// Per luminosity block event counts for the normalization
+//
+// Created by Samvel Khalatyan, Mar 8, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_LUMI_SUMMARY
+#define BSM_LUMI_SUMMARY
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bsm
+{
+    // Summary keeps per (run, lumi) number of events that pass each
+    // processing stage and channel, sum of in-time pileup interactions and
+    // stored triggers accept counts. Records are written as JSON:
+    //
+    //  {"stages": [...], "channels": [...], "triggers": [...],
+    //   "lumis": [[run, lumi, [stages], [channels], pileup,
+    //              [[trigger, accepts], ...]], ...]}
+    //
+    // where trigger is an index in the triggers list
+    //
+    class LumiSummary
+    {
+        public:
+            enum Stage
+            {
+                SEEN = 0,
+                CERTIFIED,
+                UNIQUE,
+                TRIGGER,
+                SELECTED,
+                STAGES
+            };
+
+            typedef std::vector<std::string> Channels;
+
+            LumiSummary(const Channels &);
+
+            // Select record for all subsequent calls
+            //
+            void beginLumi(const uint32_t &run, const uint32_t &lumi);
+
+            void pass(const Stage &);
+            void passChannels(const uint32_t &mask);
+            void addPileup(const uint32_t &interactions);
+
+            // Triggers are identified by name hash
+            //
+            void addTrigger(const std::size_t &hash, const std::string &name);
+            void acceptTrigger(const std::size_t &hash);
+
+            bool write(const std::string &filename) const;
+
+        private:
+            typedef std::vector<uint64_t> Counts;
+
+            struct Record
+            {
+                Counts stages;
+                Counts channels;
+                uint64_t pileup;
+
+                // Trigger index -> accepts
+                //
+                std::map<uint32_t, uint64_t> triggers;
+            };
+
+            typedef std::pair<uint32_t, uint32_t> Lumi;
+            typedef std::map<Lumi, Record> Records;
+            typedef std::map<std::size_t, uint32_t> TriggerIndices;
+            typedef std::vector<std::string> Names;
+
+            Channels _channels;
+
+            Records _records;
+            Record *_record;
+
+            TriggerIndices _trigger_indices;
+            Names _triggers;
+    };
+}
+
+#endif
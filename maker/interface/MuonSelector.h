@@ -6,8 +6,14 @@
 #ifndef BSM_MUON_SELECTOR
 #define BSM_MUON_SELECTOR
 
+#include <stdint.h>
+
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
+#include "bsm_input_maker/maker/interface/CutEngine.h"
+#include "bsm_input_maker/maker/interface/Kinematics.h"
 #include "bsm_input_maker/maker/interface/Selector.h"
 
 namespace pat
@@ -15,26 +21,68 @@ namespace pat
     class Muon;
 }
 
+namespace reco
+{
+    class Vertex;
+}
+
 namespace bsm
 {
     class MuonSelector: public Selector
     {
         public:
             MuonSelector(const edm::InputTag &muon_tag,
-                    const edm::InputTag &primary_vertex_tag);
+                    const edm::ParameterSet &cuts);
+
+            // Selected muon and quantities evaluated during selection. The
+            // record is used to fill output instead of dereferencing tracks
+            // again
+            //
+            struct Candidate
+            {
+                const pat::Muon *muon;
+
+                float d0;
 
-            typedef std::vector<const pat::Muon *> Muons;
+                bool has_inner_track;
+                uint32_t inner_track_hits;
+                float inner_track_normalized_chi2;
+                uint32_t pixel_layers;
+
+                bool has_global_track;
+                uint32_t global_track_muon_hits;
+                float global_track_normalized_chi2;
+            };
+
+            typedef std::vector<Candidate> Muons;
+
+            // Cuts input: candidate is completed with track quantities only
+            // when a track cut is reached
+            //
+            struct CutInput
+            {
+                Candidate candidate;
+
+                const reco::Vertex *primary_vertex;
+                bool is_tracks_loaded;
+            };
             
-            virtual bool init(const edm::Event *);
+            virtual bool init(const EventContext &);
 
             const Muons &muon() const;
 
-            const edm::InputTag &primaryVertexTag() const;
+            // Dereference muon tracks and fill candidate track quantities
+            //
+            static void loadTracks(CutInput &);
 
         private:
+            typedef CutEngine<CutInput> Cuts;
+
             Muons _muon;
 
-            edm::InputTag _primary_vertex_tag;
+            Kinematics _kinematics;
+
+            boost::shared_ptr<Cuts> _cuts;
     };
 }
 
@@ -6,6 +6,10 @@
 #ifndef BSM_SELECTOR
 #define BSM_SELECTOR
 
+#include <stdint.h>
+
+#include <cstddef>
+
 #include "FWCore/Framework/interface/Frameworkfwd.h"
 #include "FWCore/Utilities/interface/InputTag.h"
 
@@ -16,10 +20,32 @@ namespace reco
 
 namespace bsm
 {
+    class EventContext;
+
     namespace selector
     {
         bool isGoodPrimaryVertex(const reco::Vertex &vertex,
                                  const bool &is_real_data = false);
+
+        // Calculate dR^2 between reference direction (eta, phi) and each
+        // of size candidates given as contiguous eta, phi arrays. Results
+        // are written into dr2 array. The loop has no branches and no sqrt
+        // so that compiler can vectorize it across candidates: compare the
+        // output against cone^2
+        //
+        void deltaR2(const float &eta, const float &phi,
+                     const float *etas, const float *phis,
+                     const std::size_t &size,
+                     float *dr2);
+
+        // Set pass[i] to 1 if min_pt < pt[i] and max_abs_eta > |eta[i]|,
+        // otherwise to 0. Branch-free loop over contiguous arrays for the
+        // compiler to vectorize
+        //
+        void kinematics(const float *pts, const float *etas,
+                        const std::size_t &size,
+                        const float &min_pt, const float &max_abs_eta,
+                        uint32_t *pass);
     }
 
     class Selector
@@ -0,0 +1,76 @@
+// Compact trigger filter keys
+//
+// Created by Samvel Khalatyan, Mar 21, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_TRIGGER_FILTER_KEYS
+#define BSM_TRIGGER_FILTER_KEYS
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "bsm_input_maker/bsm_input/interface/Trigger.pb.h"
+
+namespace bsm
+{
+    // Filter keys are indices of the event trigger objects. Encoded keys
+    // are stored in the TRIGGER_FILTER_KEYS extra field instead of the
+    // repeated key field as bytes: mode followed by
+    //
+    //  DELTA   number of keys and zigzag varint differences to the
+    //          previous key (0 for the first key), order is kept
+    //  BITMAP  first key and bit per key starting from the first key;
+    //          used for strictly ascending keys if it is shorter
+    //  REPEAT  varint distance to the earlier filter of the event with the
+    //          same keys
+    //
+    // Filters of one path often share keys: the last filters are compared
+    // to every new one. Encoder keeps state of the event and should be
+    // cleared before the first filter
+    //
+    class TriggerFilterKeys
+    {
+        public:
+            typedef std::vector<uint32_t> Keys;
+            typedef ::google::protobuf::RepeatedPtrField<TriggerFilter>
+                Filters;
+
+            enum Mode
+            {
+                DELTA = 0,
+                BITMAP,
+                REPEAT
+            };
+
+            TriggerFilterKeys();
+
+            void clear();
+
+            // Encode keys of the next filter in the event. Bytes are stored
+            // in the TRIGGER_FILTER_KEYS field; empty bytes are not stored
+            //
+            const std::string &encode(const Keys &);
+
+            // Keys of the event filter: encoded or in the key field
+            //
+            static void decode(const Filters &,
+                    const int &filter,
+                    Keys &);
+
+        private:
+            // Encode keys in DELTA or BITMAP mode
+            //
+            void pack(const Keys &);
+
+            // Last encoded filters keys
+            //
+            std::vector<Keys> _recent;
+            uint32_t _filters;
+
+            std::string _bytes;
+    };
+}
+
+#endif
@@ -0,0 +1,109 @@
+// Semileptonic ttbar reconstruction hypotheses
+//
+// Created by Samvel Khalatyan, Mar 19, 2012
+// Copyright 2012, All rights reserved
+
+#ifndef BSM_TTBAR_HYPOTHESES
+#define BSM_TTBAR_HYPOTHESES
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "DataFormats/Math/interface/LorentzVector.h"
+
+namespace edm
+{
+    class ParameterSet;
+}
+
+namespace bsm
+{
+    // Jets are assigned to the leptonic top b, hadronic top b and W
+    // quarks. Neutrino pz is solved from the W mass constraint with MET.
+    // Hypothesis quality is
+    //
+    //  chi2 = ((m_jj - m_W) / s_W)^2
+    //      + ((m_bjj - m_top) / s_top)^2
+    //      + ((m_lvb - m_top) / s_top)^2
+    //
+    // Combinatorics is pruned: only leading jets are used, b positions are
+    // taken by b-tagged jets if at least two jets are tagged (in the
+    // discriminator order), combinations with any mass outside the window
+    // are dropped and partial chi2 is bounded by the worst kept hypothesis.
+    //
+    // Reconstruction keeps no state: it may run concurrently for different
+    // events with one configuration
+    //
+    class TtbarHypotheses
+    {
+        public:
+            typedef math::XYZTLorentzVector LorentzVector;
+            typedef std::vector<LorentzVector> LorentzVectors;
+            typedef std::vector<float> Floats;
+
+            // Jets are indices in the input arrays
+            //
+            struct Hypothesis
+            {
+                uint8_t leptonic_b;
+                uint8_t hadronic_b;
+                uint8_t first_quark;
+                uint8_t second_quark;
+                uint8_t neutrino;
+
+                float chi2;
+
+                // Indices in bytes from leptonic b, neutrino solution is
+                // the fifth byte
+                //
+                uint64_t pack() const;
+            };
+
+            typedef std::vector<Hypothesis> Hypotheses;
+
+            TtbarHypotheses(const edm::ParameterSet &);
+
+            // Name of the b-tag discriminator used for ordering
+            //
+            const std::string &btag() const;
+
+            // Best hypotheses in the chi2 order
+            //
+            void reconstruct(const LorentzVector &lepton,
+                    const double &met_px,
+                    const double &met_py,
+                    const LorentzVectors &jets,
+                    const Floats &btags,
+                    Hypotheses &) const;
+
+            // Neutrino pz solutions: real part is used if there are none.
+            // Return number of solutions
+            //
+            int neutrino(const LorentzVector &lepton,
+                    const double &met_px,
+                    const double &met_py,
+                    LorentzVector *solutions) const;
+
+        private:
+            void keep(const Hypothesis &, Hypotheses &) const;
+
+            uint32_t _max_jets;
+            uint32_t _max_hypotheses;
+
+            std::string _btag;
+            float _btag_cut;
+
+            double _w_mass;
+            double _w_sigma;
+            double _top_mass;
+            double _top_sigma;
+
+            // Pull limit of each mass
+            //
+            double _max_pull;
+    };
+}
+
+#endif
@@ -6,9 +6,21 @@
 #ifndef BSM_UTILITY
 #define BSM_UTILITY
 
+#include <stdint.h>
+
+#include <string>
+
 #include "DataFormats/Math/interface/LorentzVector.h"
 #include "DataFormats/Math/interface/Point3D.h"
 
+namespace google
+{
+    namespace protobuf
+    {
+        class Message;
+    }
+}
+
 namespace bsm
 {
     class LorentzVector;
@@ -18,6 +30,20 @@ namespace bsm
     {
         void set(LorentzVector *bsm_p4, const math::XYZTLorentzVector *cms_p4);
         void set(Vector *bsm_v, const math::XYZPoint *cms_v);
+
+        // Add unknown field to the message, see ExtraFields.h
+        //
+        void addVarint(google::protobuf::Message *,
+                const int &field,
+                const uint64_t &value);
+
+        void addString(google::protobuf::Message *,
+                const int &field,
+                const std::string &value);
+
+        void addFloat(google::protobuf::Message *,
+                const int &field,
+                const float &value);
     }
 }
 
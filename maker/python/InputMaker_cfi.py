@@ -10,19 +10,145 @@ InputMaker = cms.EDAnalyzer(
     pileup = cms.InputTag("addPileupInfo::HLT"),
 
     gen_particle = cms.InputTag("prunedGenParticles::PAT"),
-    
-    # Define, now deep in the decay tree the gen-particles should be searched
+
+    # Stored gen-particle trees (at most 32 rules). Roots match any of
+    # |pdgId| in pdg_ids and status in statuses; particle belongs to the
+    # first rule that matches. Children with status in child_statuses are
+    # stored down to depth levels (at most 10). Scan over the collection
+    # stops once every rule found max_roots roots (0 - no limit). Default is
+    # status 3 top quarks with status 3 children
+    #
+    gen_particle_trees = cms.VPSet(
+        cms.PSet(
+            pdg_ids = cms.vuint32(6),
+            statuses = cms.vuint32(3),
+            child_statuses = cms.vuint32(3),
+            depth = cms.uint32(2),
+            max_roots = cms.uint32(0)
+        )
+    ),
+
+    # Jet generator parton is stored as index of the particle in the
+    # gen_particle trees if it is there, full copy is stored otherwise.
+    # Readers must resolve the index extra field: the output format
+    # changes, keep disabled unless readers support it
     #
-    gen_particle_depth_level = cms.uint32(2),
+    gen_parton_by_index = cms.bool(False),
 
     jet = cms.InputTag("goodPatJetsPFlow::PAT"),
     jec = cms.vstring(),
     rho = cms.InputTag("kt6PFJetsPFlow:rho:PAT"),
 
+    # Interpolate pt-only JEC levels on a grid with given number of points
+    # per bin (0 - exact formula). Grid is not used for a level if the
+    # relative deviation from the formula exceeds tolerance
+    #
+    jec_grid_points = cms.uint32(0),
+    jec_grid_tolerance = cms.double(0.001),
+
+    # Leptons within the cone are subtracted from the jet before JEC
+    #
+    jet_lepton_cone = cms.double(0.5),
+
     electron = cms.InputTag("selectedPatElectronsLoosePFlow::PAT"),
     muon = cms.InputTag("selectedPatMuonsLoosePFlow::PAT"),
 
+    # Selection cuts. Remove a threshold (or set boolean cut to False) to
+    # disable the cut. Cuts are reordered every reorder_every objects to
+    # evaluate cheap cuts with high rejection rate first (0 - keep order).
+    # Cut cost is measured for every sample_every call
+    #
+    electron_selection = cms.PSet(
+        pt = cms.double(30),
+        eta = cms.double(2.5)
+    ),
+
+    muon_selection = cms.PSet(
+        pt = cms.double(35),
+        eta = cms.double(2.1),
+        is_global = cms.bool(True),
+        is_tracker = cms.bool(True),
+        matches = cms.double(1),
+        global_track_muon_hits = cms.double(0),
+        global_track_chi2 = cms.double(10),
+        inner_track_hits = cms.double(10),
+        pixel_layers = cms.double(0),
+        d0 = cms.double(0.02),
+        dz = cms.double(1),
+
+        reorder_every = cms.uint32(1000),
+        sample_every = cms.uint32(16)
+    ),
+
+    # Jet cuts are applied after leptons removal and JEC
+    #
+    jet_selection = cms.PSet(
+        pt = cms.double(50),
+        eta = cms.double(2.4)
+    ),
+
+    # Evaluate JES/JER variations in the same pass: each JES source ("" for
+    # the uncertainty file without sections) and JER add up and down
+    # variations. JER scale factors are given per |eta| bin upper edge and
+    # applied to jets matched to generator jets: nominal jets are smeared
+    # with central factors, up and down replace the central one. Event is
+    # kept if any variation passes the selection; pass bits are stored per
+    # jet and event
+    #
+    jet_systematics = cms.PSet(
+        jes_uncertainty = cms.string(""),
+        jes_sources = cms.vstring(""),
+        jer_eta = cms.vdouble(),
+        jer_central = cms.vdouble(),
+        jer_up = cms.vdouble(),
+        jer_down = cms.vdouble()
+    ),
+
+    # Best max_hypotheses semileptonic ttbar hypotheses of the leading
+    # max_jets (up to 16) nominal jets with the leading lepton and MET. B
+    # positions are taken by jets with btag >= btag_cut if at least two are
+    # tagged. Hypotheses with any mass pull above max_pull are dropped
+    #
+    ttbar_hypotheses = cms.PSet(
+        enable = cms.bool(False),
+        max_jets = cms.uint32(6),
+        max_hypotheses = cms.uint32(5),
+        btag = cms.string("trackCountingHighEffBJetTags"),
+        btag_cut = cms.double(3.3),
+        w_mass = cms.double(80.4),
+        w_sigma = cms.double(10),
+        top_mass = cms.double(172.5),
+        top_sigma = cms.double(15),
+        max_pull = cms.double(3)
+    ),
+
+    # Selection channels evaluated on the same selected objects. Number of
+    # electrons, muons and jets is given as (min) or (min, max) range; jets
+    # pass if any jet variation is in range. Channel events are written into
+    # own output_filename stream or, if empty, into the main stream; the
+    # main stream is not created if no channel uses it. All streams store
+    # the channel pass bits per event and the trigger menu
+    #
+    channels = cms.VPSet(
+        cms.PSet(
+            name = cms.string("ejets"),
+            electrons = cms.vuint32(1, 1),
+            muons = cms.vuint32(0, 0),
+            jets = cms.vuint32(2),
+            output_filename = cms.string("")
+        )
+    ),
+
     primary_vertex = cms.InputTag("goodOfflinePrimaryVertices::PAT"),
+
+    # Stored vertices: all, good (pass isGoodPrimaryVertex) or first
+    # max_vertices of the collection. Every stored vertex has the good bit,
+    # event has the number of all and good vertices in the collection
+    #
+    primary_vertex_storage = cms.PSet(
+        mode = cms.string("all"),
+        max_vertices = cms.uint32(0)
+    ),
     missing_energy = cms.InputTag("patMETsPFlow::PAT"),
 
     hlt = cms.InputTag("TriggerResults::HLT"),
@@ -40,5 +166,106 @@ InputMaker = cms.EDAnalyzer(
     #
     hlt_filter_pattern = cms.string("^.*$"),
 
+    # Filter keys storage: plain - repeated key field, compact - packed
+    # delta or bitmap encoding in the extra field, filters with the same
+    # keys refer to the earlier filter (see TriggerFilterKeys.h)
+    #
+    trigger_filter_keys = cms.string("plain"),
+
+    # Directory of the parsed HLT menus shared by jobs (empty - disabled).
+    # Menus are keyed by HLT table, process and path/filter patterns
+    #
+    hlt_menu_cache = cms.string(""),
+
+    # Certification JSON: events in other lumi sections are rejected before
+    # any processing (empty - accept all)
+    #
+    lumi_mask = cms.string(""),
+
+    # Drop events with already written (run, lumi, event) ID. IDs are kept
+    # exactly up to exact_limit, then in Bloom filter sized for
+    # expected_events. Bloom filter positives are confirmed in the exact
+    # store: sorted binary files store_filename.N, removed at the end of the
+    # job. Seed files are index files of previous outputs: text with
+    # "run lumi event" per line; written IDs are appended to index_filename
+    #
+    duplicate_filter = cms.PSet(
+        enable = cms.bool(False),
+        exact_limit = cms.uint32(1000000),
+        expected_events = cms.uint32(50000000),
+        false_positive_rate = cms.double(1e-6),
+        seed_files = cms.vstring(),
+        index_filename = cms.string(""),
+        store_filename = cms.string("duplicate_filter.ids")
+    ),
+
+    # Journal of the written events IDs (empty - disabled). Output files are
+    # written in parts (out.pb -> out_000.pb, out_001.pb, ...): every
+    # every_events written events, and at the end of job, the part is
+    # closed and the journal is synced. With resume the journal of the
+    # failed attempt is validated, truncated to the last complete
+    # checkpoint and its events are skipped; writing continues with the
+    # part after the checkpoint. Otherwise the journal is started over.
+    # Resume can not be used with lumi_summary or histograms: these are not
+    # restored for the skipped events
+    #
+    checkpoint = cms.PSet(
+        journal_filename = cms.string(""),
+        every_events = cms.uint32(5000),
+        resume = cms.bool(False)
+    ),
+
+    # JSON sidecar with per (run, lumi) number of events that pass each
+    # stage and channel, sum of in-time pileup interactions and accept
+    # counts of the stored triggers (empty - do not write)
+    #
+    lumi_summary = cms.string(""),
+
+    # Event message is cleared and its sub-messages, including the packed
+    # trigger filter keys strings, are reused between events.
+    # Retained memory (not allocations) is measured every sample_every
+    # events (0 - never); message is replaced if it retains more than
+    # max_bytes (0 - no limit). Counters are reported in the job report at
+    # the end of job
+    #
+    event_recycling = cms.PSet(
+        sample_every = cms.uint32(1000),
+        max_bytes = cms.uint32(256 * 1024 * 1024)
+    ),
+
+    # Serialized bytes of the written events are measured every
+    # sample_every events (0 - never) per field path down to depth levels
+    # (e.g. 2 - jet.btag) and per message type. Ranked tables are logged at
+    # the end of job and written into json_filename if set
+    #
+    byte_budget = cms.PSet(
+        sample_every = cms.uint32(0),
+        depth = cms.uint32(2),
+        json_filename = cms.string("")
+    ),
+
+    # Control histograms written with TFileService: pre stage is filled for
+    # certified unique events with input collections, post stage - for
+    # written events with selected objects. Variables: jet_pt, jet_eta,
+    # electron_pt, electron_eta, electron_isolation, muon_pt, muon_eta,
+    # muon_isolation, npv, met, pileup (in-time interactions)
+    #
+    histograms = cms.VPSet(),
+
+    # Match selected objects to trigger objects of the saved filters that
+    # match patterns (empty - no matching). Indices of the trigger objects
+    # within the cone and of their filters are stored in each object
+    #
+    trigger_matching = cms.PSet(
+        electron_filters = cms.vstring(),
+        electron_cone = cms.double(0.1),
+
+        muon_filters = cms.vstring(),
+        muon_cone = cms.double(0.1),
+
+        jet_filters = cms.vstring(),
+        jet_cone = cms.double(0.3)
+    ),
+
     input_type = cms.string("unknown")
 )
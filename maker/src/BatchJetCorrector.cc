@@ -0,0 +1,436 @@
+// Apply factorized Jet Energy Corrections to all jets in the event at once
+//
+// Created by Samvel Khalatyan, Feb 23, 2012
+// Copyright 2012, All rights reserved
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include <TFormula.h>
+
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "CondFormats/JetMETObjects/interface/SimpleJetCorrector.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/BatchJetCorrector.h"
+
+using namespace bsm;
+using namespace edm;
+using namespace std;
+
+// Single correction level
+//
+class BatchJetCorrector::Level
+{
+    public:
+        Level(const JetCorrectorParameters &);
+
+        const string &name() const;
+
+        float correction(const float *values);
+
+        void useGrid(const uint32_t &points, const float &tolerance);
+
+    private:
+        typedef vector<Variable> Variables;
+        typedef vector<double> Doubles;
+
+        Variable variable(const string &name) const;
+
+        int bin(const float *values);
+
+        float exact(const int &bin, const float *values);
+        float interpolate(const int &bin, const float &pt) const;
+
+        JetCorrectorParameters _parameters;
+
+        Variables _bin_variables;
+        Variables _par_variables;
+
+        // Response levels are inverted numerically: leave them to CMSSW
+        //
+        boost::shared_ptr<SimpleJetCorrector> _response;
+
+        boost::shared_ptr<TFormula> _formula;
+
+        // Per bin parameter variable ranges and formula parameters
+        //
+        vector<Floats> _ranges;
+        vector<Doubles> _formula_parameters;
+
+        // Sorted lower and upper edges of one dimensional binning. Empty
+        // if level uses several bin variables
+        //
+        Floats _bin_min;
+        Floats _bin_max;
+
+        Floats _bin_values;
+        Floats _par_values;
+
+        // Interpolation grid: per bin corrections in log(pt) nodes
+        //
+        vector<Floats> _grid;
+        Floats _grid_log_pt_min;
+        Floats _grid_log_pt_step;
+};
+
+BatchJetCorrector::BatchJetCorrector(const Parameters &parameters)
+{
+    for(Parameters::const_iterator level = parameters.begin();
+            parameters.end() != level;
+            ++level)
+    {
+        _levels.push_back(LevelPtr(new Level(*level)));
+    }
+}
+
+void BatchJetCorrector::useGrid(const uint32_t &points, const float &tolerance)
+{
+    for(Levels::iterator level = _levels.begin();
+            _levels.end() != level;
+            ++level)
+    {
+        (*level)->useGrid(points, tolerance);
+    }
+}
+
+void BatchJetCorrector::correct(const Floats &eta,
+        const Floats &pt,
+        const Floats &energy,
+        const Floats &area,
+        const float &rho,
+        const float &npv,
+        Floats &corrections)
+{
+    const size_t jets = eta.size();
+    corrections.resize(jets);
+
+    float values[VARIABLES];
+    values[RHO] = rho;
+    values[NPV] = npv;
+
+    for(size_t jet = 0; jets > jet; ++jet)
+    {
+        values[JET_ETA] = eta[jet];
+        values[JET_PT] = pt[jet];
+        values[JET_E] = energy[jet];
+        values[JET_A] = area[jet];
+
+        // Each level is applied to the jet corrected by previous levels
+        //
+        float correction = 1;
+        for(Levels::iterator level = _levels.begin();
+                _levels.end() != level;
+                ++level)
+        {
+            const float factor = (*level)->correction(values);
+
+            correction *= factor;
+            values[JET_PT] *= factor;
+            values[JET_E] *= factor;
+        }
+
+        corrections[jet] = correction;
+    }
+}
+
+
+
+// Level
+//
+BatchJetCorrector::Level::Level(const JetCorrectorParameters &parameters):
+    _parameters(parameters)
+{
+    typedef vector<string> Names;
+
+    const JetCorrectorParameters::Definitions &definitions =
+        _parameters.definitions();
+
+    const Names &bin_names = definitions.binVar();
+    for(Names::const_iterator name = bin_names.begin();
+            bin_names.end() != name;
+            ++name)
+    {
+        _bin_variables.push_back(variable(*name));
+    }
+
+    const Names &par_names = definitions.parVar();
+    if (4 < par_names.size())
+        throw cms::Exception("BatchJetCorrector")
+            << "too many parameter variables in level " << name();
+
+    for(Names::const_iterator name = par_names.begin();
+            par_names.end() != name;
+            ++name)
+    {
+        _par_variables.push_back(variable(*name));
+    }
+
+    _bin_values.resize(_bin_variables.size());
+    _par_values.resize(_par_variables.size());
+
+    if (definitions.isResponse())
+    {
+        _response.reset(new SimpleJetCorrector(_parameters));
+
+        return;
+    }
+
+    // Formula is compiled once per level
+    //
+    ostringstream formula_name;
+    formula_name << "bsm_jec_" << this;
+    _formula.reset(new TFormula(formula_name.str().c_str(),
+                definitions.formula().c_str()));
+
+    // Split records parameters into variable ranges and formula parameters
+    //
+    const size_t ranges = 2 * _par_variables.size();
+    bool is_sorted = 1 == _bin_variables.size();
+    for(size_t bin = 0, bins = _parameters.size(); bins > bin; ++bin)
+    {
+        const JetCorrectorParameters::Record &record = _parameters.record(bin);
+        const Floats &parameters = record.parameters();
+
+        _ranges.push_back(Floats(parameters.begin(),
+                    parameters.begin() + min(ranges, parameters.size())));
+
+        _formula_parameters.push_back(Doubles());
+        if (ranges < parameters.size())
+            _formula_parameters.back().assign(parameters.begin() + ranges,
+                    parameters.end());
+
+        if (1 == _bin_variables.size())
+        {
+            if (!_bin_min.empty() && record.xMin(0) < _bin_min.back())
+                is_sorted = false;
+
+            _bin_min.push_back(record.xMin(0));
+            _bin_max.push_back(record.xMax(0));
+        }
+    }
+
+    // Fall back to CMSSW bin search for unsorted or multi-dim binning
+    //
+    if (!is_sorted)
+    {
+        _bin_min.clear();
+        _bin_max.clear();
+    }
+}
+
+const string &BatchJetCorrector::Level::name() const
+{
+    return _parameters.definitions().level();
+}
+
+float BatchJetCorrector::Level::correction(const float *values)
+{
+    if (_response)
+    {
+        for(size_t i = 0, size = _bin_variables.size(); size > i; ++i)
+            _bin_values[i] = values[_bin_variables[i]];
+
+        for(size_t i = 0, size = _par_variables.size(); size > i; ++i)
+            _par_values[i] = values[_par_variables[i]];
+
+        return _response->correction(_bin_values, _par_values);
+    }
+
+    const int jet_bin = bin(values);
+    if (0 > jet_bin)
+        return 1;
+
+    if (!_grid.empty())
+        return interpolate(jet_bin, values[JET_PT]);
+
+    return exact(jet_bin, values);
+}
+
+void BatchJetCorrector::Level::useGrid(const uint32_t &points,
+        const float &tolerance)
+{
+    _grid.clear();
+    _grid_log_pt_min.clear();
+    _grid_log_pt_step.clear();
+
+    // Only levels with jet pt as the only parameter variable are tabulated
+    //
+    if (_response
+            || 1 != _par_variables.size()
+            || JET_PT != _par_variables[0]
+            || 2 > points)
+        return;
+
+    const size_t bins = _ranges.size();
+    for(size_t bin = 0; bins > bin; ++bin)
+    {
+        if (2 > _ranges[bin].size()
+                || 0 >= _ranges[bin][0]
+                || _ranges[bin][0] >= _ranges[bin][1])
+        {
+            LogWarning("BatchJetCorrector")
+                << "grid is not used for level " << name()
+                << ": unsupported pt range in bin " << bin;
+
+            _grid.clear();
+            _grid_log_pt_min.clear();
+            _grid_log_pt_step.clear();
+
+            return;
+        }
+
+        const float log_pt_min = log(_ranges[bin][0]);
+        const float log_pt_step = (log(_ranges[bin][1]) - log_pt_min)
+            / (points - 1);
+
+        _grid_log_pt_min.push_back(log_pt_min);
+        _grid_log_pt_step.push_back(log_pt_step);
+
+        float values[VARIABLES] = {0};
+
+        _grid.push_back(Floats(points));
+        for(uint32_t node = 0; points > node; ++node)
+        {
+            values[JET_PT] = exp(log_pt_min + node * log_pt_step);
+
+            _grid.back()[node] = exact(bin, values);
+        }
+    }
+
+    // Validate the grid in the middle of each interval where the linear
+    // interpolation error is the largest
+    //
+    float max_deviation = 0;
+    for(size_t bin = 0; bins > bin; ++bin)
+    {
+        float values[VARIABLES] = {0};
+
+        for(uint32_t node = 0; points - 1 > node; ++node)
+        {
+            values[JET_PT] = exp(_grid_log_pt_min[bin]
+                    + (node + 0.5) * _grid_log_pt_step[bin]);
+
+            const float expected = exact(bin, values);
+            if (!expected)
+                continue;
+
+            const float deviation = fabs(interpolate(bin, values[JET_PT])
+                    / expected - 1);
+
+            max_deviation = max(max_deviation, deviation);
+        }
+    }
+
+    if (tolerance < max_deviation)
+    {
+        LogWarning("BatchJetCorrector")
+            << "grid is not used for level " << name()
+            << ": max deviation " << max_deviation
+            << " exceeds tolerance " << tolerance;
+
+        _grid.clear();
+        _grid_log_pt_min.clear();
+        _grid_log_pt_step.clear();
+    }
+    else
+    {
+        LogInfo("BatchJetCorrector")
+            << "use grid for level " << name()
+            << " with " << points << " points, max deviation "
+            << max_deviation;
+    }
+}
+
+
+
+// Level privates
+//
+BatchJetCorrector::Variable
+    BatchJetCorrector::Level::variable(const string &name) const
+{
+    if ("JetEta" == name)
+        return JET_ETA;
+
+    else if ("JetPt" == name)
+        return JET_PT;
+
+    else if ("JetE" == name)
+        return JET_E;
+
+    else if ("JetA" == name)
+        return JET_A;
+
+    else if ("Rho" == name)
+        return RHO;
+
+    else if ("NPV" == name)
+        return NPV;
+
+    throw cms::Exception("BatchJetCorrector")
+        << "unsupported variable " << name << " in level "
+        << _parameters.definitions().level();
+}
+
+int BatchJetCorrector::Level::bin(const float *values)
+{
+    if (_bin_min.empty())
+    {
+        for(size_t i = 0, size = _bin_variables.size(); size > i; ++i)
+            _bin_values[i] = values[_bin_variables[i]];
+
+        return _parameters.binIndex(_bin_values);
+    }
+
+    // Binary search of the last bin with lower edge below value
+    //
+    const float value = values[_bin_variables[0]];
+    const Floats::const_iterator upper =
+        upper_bound(_bin_min.begin(), _bin_min.end(), value);
+
+    if (_bin_min.begin() == upper)
+        return -1;
+
+    const int bin = upper - _bin_min.begin() - 1;
+
+    return value < _bin_max[bin] ? bin : -1;
+}
+
+float BatchJetCorrector::Level::exact(const int &bin, const float *values)
+{
+    // Parameter variables are clamped to the bin range
+    //
+    const Floats &ranges = _ranges[bin];
+
+    double x[4] = {0, 0, 0, 0};
+    for(size_t i = 0, size = _par_variables.size(); size > i; ++i)
+    {
+        const float value = values[_par_variables[i]];
+
+        x[i] = 2 * i + 1 < ranges.size()
+            ? min(max(value, ranges[2 * i]), ranges[2 * i + 1])
+            : value;
+    }
+
+    Doubles &parameters = _formula_parameters[bin];
+
+    return _formula->EvalPar(x, parameters.empty() ? 0 : &parameters[0]);
+}
+
+float BatchJetCorrector::Level::interpolate(const int &bin,
+        const float &pt) const
+{
+    const Floats &grid = _grid[bin];
+    const float position = (log(min(max(pt, _ranges[bin][0]),
+                    _ranges[bin][1])) - _grid_log_pt_min[bin])
+        / _grid_log_pt_step[bin];
+
+    const size_t node = min(static_cast<size_t>(max(position, 0.0f)),
+            grid.size() - 2);
+    const float fraction = position - node;
+
+    return grid[node] + fraction * (grid[node + 1] - grid[node]);
+}
@@ -0,0 +1,357 @@
+// Serialized bytes per event field for the output size budget
+//
+// Created by Samvel Khalatyan, Mar 20, 2012
+// Copyright 2012, All rights reserved
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+
+#include <boost/lexical_cast.hpp>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/message.h>
+#include <google/protobuf/unknown_field_set.h>
+#include <google/protobuf/wire_format.h>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "bsm_input_maker/maker/interface/ByteBudget.h"
+
+using namespace std;
+
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+using google::protobuf::Reflection;
+using google::protobuf::UnknownField;
+using google::protobuf::UnknownFieldSet;
+using google::protobuf::io::CodedOutputStream;
+using google::protobuf::internal::WireFormat;
+
+using bsm::ByteBudget;
+
+namespace
+{
+    // Entry of the fields below the depth
+    //
+    const uint32_t NO_ENTRY = 0xffffffffu;
+
+    struct MoreBytes
+    {
+        template<typename T>
+            bool operator()(const T &a, const T &b) const
+            {
+                return a.bytes > b.bytes;
+            }
+    };
+
+    uint64_t unknownFieldSize(const UnknownField &field)
+    {
+        const uint64_t tag = CodedOutputStream::VarintSize32(
+                static_cast<uint32_t>(field.number()) << 3);
+
+        switch(field.type())
+        {
+            case UnknownField::TYPE_VARINT:
+                return tag + CodedOutputStream::VarintSize64(field.varint());
+
+            case UnknownField::TYPE_FIXED32:
+                return tag + 4;
+
+            case UnknownField::TYPE_FIXED64:
+                return tag + 8;
+
+            case UnknownField::TYPE_LENGTH_DELIMITED:
+                return tag
+                    + CodedOutputStream::VarintSize32(
+                            field.length_delimited().size())
+                    + field.length_delimited().size();
+
+            case UnknownField::TYPE_GROUP:
+                return 2 * tag
+                    + WireFormat::ComputeUnknownFieldsSize(field.group());
+        }
+
+        return tag;
+    }
+
+    template<typename T>
+        void writeEntries(ostream &out, const string &name, const T &entries)
+        {
+            out << " \"" << name << "\": [";
+            for(typename T::const_iterator entry = entries.begin();
+                    entries.end() != entry;
+                    ++entry)
+            {
+                if (entries.begin() != entry)
+                    out << ",";
+
+                out << endl << "  [\"" << entry->name << "\", "
+                    << entry->bytes << ", "
+                    << entry->elements << "]";
+            }
+            out << endl << " ]";
+        }
+}
+
+ByteBudget::ByteBudget(const edm::ParameterSet &config):
+    _sample_every(config.getParameter<uint32_t>("sample_every")),
+    _depth(config.getParameter<uint32_t>("depth")),
+    _events(0),
+    _samples(0)
+{
+    _fields.push_back(Entry());
+    _fields.back().name = "event";
+}
+
+bool ByteBudget::isEnabled() const
+{
+    return _sample_every;
+}
+
+void ByteBudget::sample(const Message &event)
+{
+    ++_events;
+
+    if (!_sample_every
+            || _events % _sample_every)
+        return;
+
+    ++_samples;
+
+    // Sizes of all sub-messages are cached
+    //
+    _fields[0].bytes += event.ByteSize();
+    ++_fields[0].elements;
+
+    account(event, 0, 0);
+}
+
+uint64_t ByteBudget::events() const
+{
+    return _events;
+}
+
+uint64_t ByteBudget::samples() const
+{
+    return _samples;
+}
+
+void ByteBudget::report(ostream &out) const
+{
+    const double samples = _samples ? _samples : 1;
+    const double total = _fields[0].bytes ? _fields[0].bytes : 1;
+
+    out << "Byte budget: " << _samples << " of " << _events
+        << " events sampled" << endl;
+
+    const char *titles[] = {"field", "type"};
+    const Entries tables[] = {fields(), types()};
+    for(int table = 0; 2 > table; ++table)
+    {
+        out << endl
+            << setw(12) << "bytes/event"
+            << setw(8) << "share"
+            << setw(16) << "elements/event"
+            << "  " << titles[table] << endl;
+
+        for(Entries::const_iterator entry = tables[table].begin();
+                tables[table].end() != entry;
+                ++entry)
+        {
+            out << fixed
+                << setw(12) << setprecision(1) << entry->bytes / samples
+                << setw(7) << setprecision(1) << 100 * entry->bytes / total
+                << "%"
+                << setw(16) << setprecision(2) << entry->elements / samples
+                << "  " << entry->name << endl;
+        }
+    }
+}
+
+bool ByteBudget::write(const string &filename) const
+{
+    // Write into temporary file and move it in place
+    //
+    const string tmp_filename = filename + ".tmp";
+    {
+        ofstream out(tmp_filename.c_str(), ios::trunc);
+
+        out << "{\"events\": " << _events << ","
+            << " \"samples\": " << _samples << ","
+            << " \"bytes\": " << _fields[0].bytes << "," << endl;
+
+        writeEntries(out, "fields", fields());
+        out << "," << endl;
+
+        writeEntries(out, "types", types());
+        out << endl << "}" << endl;
+
+        if (!out)
+        {
+            remove(tmp_filename.c_str());
+
+            return false;
+        }
+    }
+
+    return !rename(tmp_filename.c_str(), filename.c_str());
+}
+
+
+
+// Privates
+//
+ByteBudget::Entry::Entry():
+    bytes(0),
+    elements(0)
+{
+}
+
+void ByteBudget::account(const Message &message,
+        const uint32_t &entry,
+        const uint32_t &level)
+{
+    const Reflection *reflection = message.GetReflection();
+
+    vector<const FieldDescriptor *> fields;
+    reflection->ListFields(message, &fields);
+
+    const bool is_path = NO_ENTRY != entry && _depth > level;
+
+    for(vector<const FieldDescriptor *>::const_iterator field = fields.begin();
+            fields.end() != field;
+            ++field)
+    {
+        uint32_t child = NO_ENTRY;
+        if (is_path)
+        {
+            child = path(entry, (*field)->number());
+            if (NO_ENTRY == child)
+                child = addPath(entry, (*field)->number(), (*field)->name());
+        }
+
+        const int size = (*field)->is_repeated()
+            ? reflection->FieldSize(message, *field)
+            : 1;
+
+        if (FieldDescriptor::CPPTYPE_MESSAGE != (*field)->cpp_type())
+        {
+            if (is_path)
+            {
+                _fields[child].bytes +=
+                    WireFormat::FieldByteSize(*field, message);
+                _fields[child].elements += size;
+            }
+
+            continue;
+        }
+
+        // Message sizes are cached by ByteSize of the event
+        //
+        const uint64_t tag =
+            WireFormat::TagSize((*field)->number(), (*field)->type());
+        const bool is_group = FieldDescriptor::TYPE_GROUP == (*field)->type();
+
+        Entry &type = _types[(*field)->message_type()];
+        if (type.name.empty())
+            type.name = (*field)->message_type()->full_name();
+
+        for(int element = 0; size > element; ++element)
+        {
+            const Message &sub_message = (*field)->is_repeated()
+                ? reflection->GetRepeatedMessage(message, *field, element)
+                : reflection->GetMessage(message, *field);
+
+            const uint32_t cached_size = sub_message.GetCachedSize();
+
+            type.bytes += cached_size;
+            ++type.elements;
+
+            if (is_path)
+            {
+                _fields[child].bytes += tag + cached_size
+                    + (is_group
+                        ? 0
+                        : CodedOutputStream::VarintSize32(cached_size));
+                ++_fields[child].elements;
+            }
+
+            account(sub_message, child, level + 1);
+        }
+    }
+
+    if (!is_path)
+        return;
+
+    const UnknownFieldSet &unknown_fields =
+        reflection->GetUnknownFields(message);
+    for(int field = 0, size = unknown_fields.field_count(); size > field;
+            ++field)
+    {
+        const UnknownField &unknown_field = unknown_fields.field(field);
+
+        uint32_t child = path(entry, unknown_field.number());
+        if (NO_ENTRY == child)
+            child = addPath(entry, unknown_field.number(),
+                    "[" + boost::lexical_cast<string>(unknown_field.number())
+                        + "]");
+
+        _fields[child].bytes += unknownFieldSize(unknown_field);
+        ++_fields[child].elements;
+    }
+}
+
+uint32_t ByteBudget::path(const uint32_t &parent, const int &number) const
+{
+    const Paths::const_iterator path =
+        _paths.find(Paths::key_type(parent, number));
+
+    return _paths.end() != path
+        ? path->second
+        : NO_ENTRY;
+}
+
+uint32_t ByteBudget::addPath(const uint32_t &parent,
+        const int &number,
+        const string &name)
+{
+    const uint32_t entry = _fields.size();
+
+    _fields.push_back(Entry());
+    _fields.back().name = parent
+        ? _fields[parent].name + "." + name
+        : name;
+
+    _paths[Paths::key_type(parent, number)] = entry;
+
+    return entry;
+}
+
+ByteBudget::Entries ByteBudget::fields() const
+{
+    // Event entry is the total and is not ranked
+    //
+    Entries entries(_fields.begin() + 1, _fields.end());
+    stable_sort(entries.begin(), entries.end(), MoreBytes());
+
+    return entries;
+}
+
+ByteBudget::Entries ByteBudget::types() const
+{
+    Entries entries;
+    for(Types::const_iterator type = _types.begin();
+            _types.end() != type;
+            ++type)
+    {
+        entries.push_back(type->second);
+    }
+
+    stable_sort(entries.begin(), entries.end(), MoreBytes());
+
+    return entries;
+}
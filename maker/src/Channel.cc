@@ -0,0 +1,89 @@
+// Event selection channel: leptons and jets multiplicity requirements
+//
+// Created by Samvel Khalatyan, Mar 5, 2012
+// Copyright 2012, All rights reserved
+
+#include <limits>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/Channel.h"
+
+using namespace std;
+
+using bsm::Channel;
+using edm::ParameterSet;
+
+Channel::Channel(const ParameterSet &config)
+{
+    _name = config.getParameter<string>("name");
+    _output_filename = config.getParameter<string>("output_filename");
+
+    _electrons = range(config, "electrons");
+    _muons = range(config, "muons");
+    _jets = range(config, "jets");
+}
+
+const string &Channel::name() const
+{
+    return _name;
+}
+
+const string &Channel::outputFilename() const
+{
+    return _output_filename;
+}
+
+bool Channel::acceptLeptons(const uint32_t &electrons,
+        const uint32_t &muons) const
+{
+    return _electrons.contains(electrons)
+        && _muons.contains(muons);
+}
+
+uint32_t Channel::acceptJets(const Counts &jets) const
+{
+    uint32_t variations = 0;
+    for(size_t variation = 0; jets.size() > variation; ++variation)
+    {
+        if (_jets.contains(jets[variation]))
+            variations |= 1u << variation;
+    }
+
+    return variations;
+}
+
+
+
+// Privates
+//
+bool Channel::Range::contains(const uint32_t &value) const
+{
+    return min <= value
+        && max >= value;
+}
+
+Channel::Range Channel::range(const ParameterSet &config,
+        const string &name)
+{
+    // Range is given as (min) or (min, max)
+    //
+    const vector<uint32_t> values =
+        config.getParameter<vector<uint32_t> >(name);
+
+    if (values.empty()
+            || 2 < values.size()
+            || (2 == values.size() && values[0] > values[1]))
+        throw cms::Exception("Channel")
+            << "bad " << name << " range in channel "
+            << config.getParameter<string>("name");
+
+    Range result;
+    result.min = values[0];
+    result.max = 2 == values.size()
+        ? values[1]
+        : numeric_limits<uint32_t>::max();
+
+    return result;
+}
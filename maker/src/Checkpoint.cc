@@ -0,0 +1,347 @@
+// Journal of written events for the job restart
+//
+// Created by Samvel Khalatyan, Mar 23, 2012
+// Copyright 2012, All rights reserved
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <sstream>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/Checkpoint.h"
+
+using namespace std;
+
+using bsm::Checkpoint;
+using edm::LogInfo;
+using edm::ParameterSet;
+
+namespace
+{
+    const uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+    const uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+    uint64_t fnv(uint64_t hash, const char *data, const size_t &size)
+    {
+        for(const char *end = data + size; end != data; ++data)
+        {
+            hash ^= static_cast<uint8_t>(*data);
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+    string checkpointLine(const uint64_t &sequence,
+            const uint64_t &events,
+            const uint64_t &checksum)
+    {
+        ostringstream line;
+        line << "checkpoint " << sequence << " " << events << " "
+            << hex << checksum << "\n";
+
+        return line.str();
+    }
+
+    // Sync closed file by name. errno is set if failed
+    //
+    bool sync(const string &filename)
+    {
+        const int file = open(filename.c_str(), O_RDONLY);
+        if (0 > file)
+            return false;
+
+        const int error = fsync(file) ? errno : 0;
+        close(file);
+
+        errno = error;
+
+        return !error;
+    }
+
+    string directory(const string &filename)
+    {
+        const size_t slash = filename.rfind('/');
+        if (string::npos == slash)
+            return ".";
+
+        return filename.substr(0, slash ? slash : 1);
+    }
+}
+
+Checkpoint::Checkpoint(const ParameterSet &config):
+    _filename(config.getParameter<string>("journal_filename")),
+    _every(config.getParameter<uint32_t>("every_events")),
+    _journal(-1),
+    _block_events(0),
+    _sequence(0),
+    _events(0),
+    _checksum(FNV_OFFSET),
+    _restored(0),
+    _dropped(0),
+    _skipped(0)
+{
+    const bool is_resume = config.getParameter<bool>("resume");
+
+    // Journal of the previous job is truncated to the last good checkpoint
+    // and continued, otherwise it is started over
+    //
+    const uint64_t size = is_resume ? restore() : 0;
+
+    _journal = open(_filename.c_str(),
+            O_WRONLY | O_CREAT | (is_resume ? 0 : O_TRUNC),
+            0644);
+    if (0 > _journal)
+        throw cms::Exception("Checkpoint")
+            << "failed to open journal " << _filename << ": "
+            << strerror(errno);
+
+    if (is_resume
+            && (ftruncate(_journal, size)
+                || 0 > lseek(_journal, size, SEEK_SET)))
+        throw cms::Exception("Checkpoint")
+            << "failed to truncate journal " << _filename << ": "
+            << strerror(errno);
+
+    if (is_resume)
+        LogInfo("Checkpoint") << "resume " << _filename << " after "
+            << _sequence << " checkpoints: " << _restored
+            << " written events are skipped, " << _dropped
+            << " events of incomplete block are processed again";
+}
+
+Checkpoint::~Checkpoint()
+{
+    if (0 <= _journal)
+        close(_journal);
+}
+
+bool Checkpoint::isWritten(const uint32_t &run,
+        const uint32_t &lumi,
+        const uint64_t &event)
+{
+    if (_written.empty())
+        return false;
+
+    Key key;
+    key.run = run;
+    key.lumi = lumi;
+    key.event = event;
+
+    if (!binary_search(_written.begin(), _written.end(), key))
+        return false;
+
+    ++_skipped;
+
+    return true;
+}
+
+void Checkpoint::add(const uint32_t &run,
+        const uint32_t &lumi,
+        const uint64_t &event)
+{
+    ostringstream line;
+    line << "event " << run << " " << lumi << " " << event << "\n";
+
+    _block += line.str();
+    ++_block_events;
+}
+
+bool Checkpoint::isDue() const
+{
+    return _every
+        && _every <= _block_events;
+}
+
+void Checkpoint::checkpoint()
+{
+    if (!_block_events)
+        return;
+
+    // Journaled events should be on disk: parts and their directory
+    // entries are synced before the journal
+    //
+    for(vector<string>::const_iterator part = _parts.begin();
+            _parts.end() != part;
+            ++part)
+    {
+        if (!sync(*part)
+                || !sync(directory(*part)))
+            throw cms::Exception("Checkpoint")
+                << "failed to sync output part " << *part << ": "
+                << strerror(errno);
+    }
+
+    _parts.clear();
+
+    _checksum = fnv(_checksum, _block.data(), _block.size());
+    _events += _block_events;
+    ++_sequence;
+
+    _block += checkpointLine(_sequence, _events, _checksum);
+
+    // Block is appended with one write: partially written block fails
+    // validation on restart
+    //
+    const char *data = _block.data();
+    for(size_t left = _block.size(); left; )
+    {
+        const ssize_t written = write(_journal, data, left);
+        if (0 > written)
+        {
+            if (EINTR == errno)
+                continue;
+
+            throw cms::Exception("Checkpoint")
+                << "failed to write journal " << _filename << ": "
+                << strerror(errno);
+        }
+
+        data += written;
+        left -= written;
+    }
+
+    if (fsync(_journal))
+        throw cms::Exception("Checkpoint")
+            << "failed to sync journal " << _filename << ": "
+            << strerror(errno);
+
+    _block.clear();
+    _block_events = 0;
+}
+
+string Checkpoint::partFilename(const string &filename)
+{
+    // Part number is the number of checkpoints: every checkpoint closes
+    // one part
+    //
+    const size_t slash = filename.rfind('/');
+    size_t dot = filename.rfind('.');
+    if (string::npos == dot
+            || (string::npos != slash && slash > dot))
+        dot = filename.size();
+
+    ostringstream part;
+    part << filename.substr(0, dot) << "_" << setw(3) << setfill('0')
+        << _sequence << filename.substr(dot);
+
+    _parts.push_back(part.str());
+
+    return part.str();
+}
+
+uint64_t Checkpoint::restored() const
+{
+    return _restored;
+}
+
+uint64_t Checkpoint::dropped() const
+{
+    return _dropped;
+}
+
+uint64_t Checkpoint::skipped() const
+{
+    return _skipped;
+}
+
+const Checkpoint::Keys &Checkpoint::written() const
+{
+    return _written;
+}
+
+
+
+// Privates
+//
+bool Checkpoint::Key::operator<(const Key &key) const
+{
+    if (run != key.run)
+        return run < key.run;
+
+    if (lumi != key.lumi)
+        return lumi < key.lumi;
+
+    return event < key.event;
+}
+
+uint64_t Checkpoint::restore()
+{
+    ifstream in(_filename.c_str(), ios::binary);
+    if (!in)
+        return 0;
+
+    const string journal((istreambuf_iterator<char>(in)),
+            istreambuf_iterator<char>());
+
+    uint64_t valid_size = 0;
+
+    Keys block;
+    size_t block_start = 0;
+    for(size_t start = 0, end = 0; journal.size() > start; start = end + 1)
+    {
+        // Line without end is cut by the crash
+        //
+        end = journal.find('\n', start);
+        if (string::npos == end)
+            break;
+
+        istringstream line(journal.substr(start, end - start));
+
+        string type;
+        line >> type;
+
+        if ("event" == type)
+        {
+            Key key;
+            if (!(line >> key.run >> key.lumi >> key.event))
+                break;
+
+            block.push_back(key);
+
+            continue;
+        }
+
+        uint64_t sequence;
+        uint64_t events;
+        uint64_t checksum;
+        if ("checkpoint" != type
+                || !(line >> sequence >> events >> hex >> checksum))
+            break;
+
+        const uint64_t block_checksum = fnv(_checksum,
+                journal.data() + block_start, start - block_start);
+
+        if (_sequence + 1 != sequence
+                || _events + block.size() != events
+                || block_checksum != checksum)
+            break;
+
+        _written.insert(_written.end(), block.begin(), block.end());
+
+        _sequence = sequence;
+        _events = events;
+        _checksum = checksum;
+
+        block.clear();
+        block_start = end + 1;
+        valid_size = block_start;
+    }
+
+    _dropped = block.size();
+    _restored = _written.size();
+
+    sort(_written.begin(), _written.end());
+
+    return valid_size;
+}
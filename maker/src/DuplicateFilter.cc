@@ -0,0 +1,523 @@
+// Suppress events with already written (run, lumi, event) ID
+//
+// Created by Samvel Khalatyan, Mar 7, 2012
+// Copyright 2012, All rights reserved
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <sstream>
+#include <utility>
+
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/DuplicateFilter.h"
+
+using namespace std;
+
+using bsm::DuplicateFilter;
+using edm::LogInfo;
+using edm::ParameterSet;
+
+namespace
+{
+    // Recent keys are merged into the sorted array in batches
+    //
+    const size_t RECENT_KEYS = 4096;
+
+    // Store runs are merged when there are more of them
+    //
+    const size_t MAX_RUNS = 16;
+
+    // Store record size in bytes
+    //
+    const size_t RECORD_SIZE = 16;
+
+    // Store runs are read in blocks of records while merged
+    //
+    const size_t READ_RECORDS = 4096;
+
+    uint64_t mix(uint64_t value)
+    {
+        value ^= value >> 33;
+        value *= 0xff51afd7ed558ccdULL;
+        value ^= value >> 33;
+        value *= 0xc4ceb9fe1a85ec53ULL;
+        value ^= value >> 33;
+
+        return value;
+    }
+}
+
+DuplicateFilter::DuplicateFilter(const ParameterSet &config):
+    _bloom_bits(0),
+    _bloom_hashes(0),
+    _is_bloom(false),
+    _store_files(0),
+    _seeded(0),
+    _duplicates(0),
+    _false_positives(0)
+{
+    _exact_limit = config.getParameter<uint32_t>("exact_limit");
+    _expected_events = max(config.getParameter<uint32_t>("expected_events"),
+            static_cast<uint32_t>(1));
+    _false_positive_rate = config.getParameter<double>("false_positive_rate");
+
+    if (0 >= _false_positive_rate
+            || 1 <= _false_positive_rate)
+        throw cms::Exception("DuplicateFilter")
+            << "false positive rate should be in (0, 1): "
+            << _false_positive_rate;
+
+    _store_filename = config.getParameter<string>("store_filename");
+    if (_store_filename.empty())
+        throw cms::Exception("DuplicateFilter")
+            << "store filename is not set";
+
+    typedef vector<string> Filenames;
+
+    const Filenames seeds = config.getParameter<Filenames>("seed_files");
+    for(Filenames::const_iterator filename = seeds.begin();
+            seeds.end() != filename;
+            ++filename)
+    {
+        seed(*filename);
+    }
+
+    const string index = config.getParameter<string>("index_filename");
+    if (!index.empty())
+        _index.reset(new ofstream(index.c_str(), ios::app));
+}
+
+DuplicateFilter::~DuplicateFilter()
+{
+    LogInfo("DuplicateFilter") << "seeded " << _seeded
+        << " IDs, rejected " << _duplicates << " duplicates, "
+        << (_is_bloom ? "Bloom filter" : "exact set") << " is used ("
+        << _false_positives << " Bloom false positives, "
+        << _runs.size() << " store runs)";
+
+    for(Runs::const_iterator run = _runs.begin(); _runs.end() != run; ++run)
+    {
+        close(run->file);
+        remove(run->filename.c_str());
+    }
+}
+
+bool DuplicateFilter::isDuplicate(const uint32_t &run,
+        const uint32_t &lumi,
+        const uint64_t &event)
+{
+    if (!contains(key(run, lumi, event)))
+        return false;
+
+    ++_duplicates;
+
+    return true;
+}
+
+void DuplicateFilter::insert(const uint32_t &run,
+        const uint32_t &lumi,
+        const uint64_t &event)
+{
+    add(key(run, lumi, event));
+
+    if (_index)
+        *_index << run << " " << lumi << " " << event << "\n";
+}
+
+void DuplicateFilter::seed(const uint32_t &run,
+        const uint32_t &lumi,
+        const uint64_t &event)
+{
+    add(key(run, lumi, event));
+
+    ++_seeded;
+}
+
+
+
+// Privates
+//
+bool DuplicateFilter::Key::operator<(const Key &key) const
+{
+    if (run != key.run)
+        return run < key.run;
+
+    if (lumi != key.lumi)
+        return lumi < key.lumi;
+
+    return event < key.event;
+}
+
+bool DuplicateFilter::Key::operator==(const Key &key) const
+{
+    return run == key.run
+        && lumi == key.lumi
+        && event == key.event;
+}
+
+DuplicateFilter::Key DuplicateFilter::key(const uint32_t &run,
+        const uint32_t &lumi,
+        const uint64_t &event)
+{
+    Key result;
+    result.run = run;
+    result.lumi = lumi;
+    result.event = event;
+
+    return result;
+}
+
+void DuplicateFilter::encode(const Key &key, char *data)
+{
+    memcpy(data, &key.run, 4);
+    memcpy(data + 4, &key.lumi, 4);
+    memcpy(data + 8, &key.event, 8);
+}
+
+void DuplicateFilter::decode(const char *data, Key &key)
+{
+    memcpy(&key.run, data, 4);
+    memcpy(&key.lumi, data + 4, 4);
+    memcpy(&key.event, data + 8, 8);
+}
+
+void DuplicateFilter::seed(const string &filename)
+{
+    ifstream in(filename.c_str());
+    if (!in)
+        throw cms::Exception("DuplicateFilter")
+            << "failed to open seed file: " << filename;
+
+    uint32_t run;
+    uint32_t lumi;
+    uint64_t event;
+    while(in >> run >> lumi >> event)
+    {
+        add(key(run, lumi, event));
+
+        ++_seeded;
+    }
+
+    if (!in.eof())
+        throw cms::Exception("DuplicateFilter")
+            << "bad line in seed file: " << filename;
+
+    LogInfo("DuplicateFilter") << "Load seed file: " << filename;
+}
+
+void DuplicateFilter::add(const Key &key)
+{
+    if (_is_bloom)
+    {
+        bloomAdd(key);
+
+        _recent.insert(key);
+        if (_exact_limit <= _recent.size())
+            flushRun();
+
+        return;
+    }
+
+    _recent.insert(key);
+    if (RECENT_KEYS <= _recent.size())
+        merge();
+
+    if (_exact_limit < _keys.size() + _recent.size())
+        useBloom();
+}
+
+bool DuplicateFilter::contains(const Key &key)
+{
+    // Bloom positives are confirmed by the exact store
+    //
+    if (_is_bloom)
+    {
+        if (!bloomContains(key))
+            return false;
+
+        if (_recent.count(key)
+                || storeContains(key))
+            return true;
+
+        ++_false_positives;
+
+        return false;
+    }
+
+    return _recent.count(key)
+        || binary_search(_keys.begin(), _keys.end(), key);
+}
+
+void DuplicateFilter::merge()
+{
+    const size_t size = _keys.size();
+
+    _keys.insert(_keys.end(), _recent.begin(), _recent.end());
+    inplace_merge(_keys.begin(), _keys.begin() + size, _keys.end());
+
+    // Seed files may overlap with each other
+    //
+    _keys.erase(unique(_keys.begin(), _keys.end()), _keys.end());
+
+    _recent.clear();
+}
+
+void DuplicateFilter::useBloom()
+{
+    // Optimal size and number of hashes for the expected number of events
+    //
+    const double ln2 = log(2.0);
+    const uint64_t events = max(static_cast<uint64_t>(_expected_events),
+            static_cast<uint64_t>(_keys.size() + _recent.size()));
+
+    _bloom_bits = max(static_cast<uint64_t>(
+                ceil(-1.0 * events * log(_false_positive_rate) / ln2 / ln2)),
+            static_cast<uint64_t>(64));
+    _bloom_hashes = min(max(static_cast<uint32_t>(
+                    floor(1.0 * _bloom_bits / events * ln2 + 0.5)), 1u), 32u);
+
+    _bloom.assign((_bloom_bits + 63) / 64, 0);
+    _is_bloom = true;
+
+    LogInfo("DuplicateFilter") << "switch to Bloom filter: "
+        << _bloom_bits / 8 / 1024 << " kB, " << _bloom_hashes << " hashes";
+
+    merge();
+
+    for(Keys::const_iterator key = _keys.begin(); _keys.end() != key; ++key)
+        bloomAdd(*key);
+
+    // Exact keys become the first store run
+    //
+    writeRun(_keys);
+
+    Keys().swap(_keys);
+}
+
+void DuplicateFilter::flushRun()
+{
+    writeRun(Keys(_recent.begin(), _recent.end()));
+
+    _recent.clear();
+}
+
+void DuplicateFilter::writeRun(const Keys &keys)
+{
+    Run run = openRun();
+    write(run, keys);
+
+    _runs.push_back(run);
+
+    if (MAX_RUNS < _runs.size())
+        mergeRuns();
+}
+
+void DuplicateFilter::mergeRuns()
+{
+    // Runs are read sequentially; the smallest head key among all runs is
+    // written next
+    //
+    typedef pair<Key, size_t> Head;
+    typedef priority_queue<Head, vector<Head>, greater<Head> > Heads;
+
+    vector<Keys> blocks(_runs.size());
+    vector<size_t> positions(_runs.size(), 0);
+    vector<uint64_t> offsets(_runs.size(), 0);
+
+    Heads heads;
+    for(size_t run = 0; _runs.size() > run; ++run)
+    {
+        if (read(_runs[run], offsets[run], blocks[run]))
+            heads.push(make_pair(blocks[run][0], run));
+    }
+
+    Run merged = openRun();
+    Keys output;
+    output.reserve(READ_RECORDS);
+
+    while(!heads.empty())
+    {
+        const Head head = heads.top();
+        heads.pop();
+
+        if (output.empty() || !(output.back() == head.first))
+            output.push_back(head.first);
+
+        if (READ_RECORDS <= output.size())
+        {
+            write(merged, output);
+            output.clear();
+        }
+
+        const size_t run = head.second;
+        if (blocks[run].size() <= ++positions[run])
+        {
+            if (!read(_runs[run], offsets[run], blocks[run]))
+                continue;
+
+            positions[run] = 0;
+        }
+
+        heads.push(make_pair(blocks[run][positions[run]], run));
+    }
+
+    if (!output.empty())
+        write(merged, output);
+
+    for(Runs::const_iterator run = _runs.begin(); _runs.end() != run; ++run)
+    {
+        close(run->file);
+        remove(run->filename.c_str());
+    }
+
+    _runs.assign(1, merged);
+}
+
+DuplicateFilter::Run DuplicateFilter::openRun()
+{
+    ostringstream filename;
+    filename << _store_filename << "." << _store_files++;
+
+    Run run;
+    run.filename = filename.str();
+    run.size = 0;
+    run.file = open(run.filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (-1 == run.file)
+        throw cms::Exception("DuplicateFilter")
+            << "failed to open store run: " << run.filename << ": "
+            << strerror(errno);
+
+    return run;
+}
+
+void DuplicateFilter::write(Run &run, const Keys &keys)
+{
+    vector<char> buffer(keys.size() * RECORD_SIZE);
+    for(size_t record = 0; keys.size() > record; ++record)
+        encode(keys[record], &buffer[record * RECORD_SIZE]);
+
+    for(size_t written = 0; buffer.size() > written; )
+    {
+        const ssize_t bytes = pwrite(run.file, &buffer[written],
+                buffer.size() - written, run.size * RECORD_SIZE + written);
+        if (0 > bytes)
+        {
+            if (EINTR == errno)
+                continue;
+
+            throw cms::Exception("DuplicateFilter")
+                << "failed to write store run: " << run.filename << ": "
+                << strerror(errno);
+        }
+
+        written += bytes;
+    }
+
+    run.size += keys.size();
+}
+
+bool DuplicateFilter::read(const Run &run, uint64_t &offset, Keys &keys)
+{
+    keys.clear();
+
+    const uint64_t records = min(static_cast<uint64_t>(READ_RECORDS),
+            run.size - offset);
+    if (!records)
+        return false;
+
+    vector<char> buffer(records * RECORD_SIZE);
+    if (static_cast<ssize_t>(buffer.size()) != pread(run.file, &buffer[0],
+                buffer.size(), offset * RECORD_SIZE))
+    {
+        throw cms::Exception("DuplicateFilter")
+            << "failed to read store run: " << run.filename << ": "
+            << strerror(errno);
+    }
+
+    keys.resize(records);
+    for(uint64_t record = 0; records > record; ++record)
+        decode(&buffer[record * RECORD_SIZE], keys[record]);
+
+    offset += records;
+
+    return true;
+}
+
+bool DuplicateFilter::storeContains(const Key &key) const
+{
+    char data[RECORD_SIZE];
+    for(Runs::const_iterator run = _runs.begin(); _runs.end() != run; ++run)
+    {
+        // Binary search over records of the sorted run
+        //
+        uint64_t first = 0;
+        uint64_t last = run->size;
+        while(first < last)
+        {
+            const uint64_t middle = first + (last - first) / 2;
+            if (static_cast<ssize_t>(RECORD_SIZE) != pread(run->file, data,
+                        RECORD_SIZE, middle * RECORD_SIZE))
+            {
+                throw cms::Exception("DuplicateFilter")
+                    << "failed to read store run: " << run->filename
+                    << ": " << strerror(errno);
+            }
+
+            Key record;
+            decode(data, record);
+
+            if (record == key)
+                return true;
+
+            if (record < key)
+                first = middle + 1;
+            else
+                last = middle;
+        }
+    }
+
+    return false;
+}
+
+void DuplicateFilter::bloomAdd(const Key &key)
+{
+    // Double hashing: i-th hash is h1 + i * h2
+    //
+    const uint64_t h1 = mix((static_cast<uint64_t>(key.run) << 32 | key.lumi)
+            ^ mix(key.event));
+    const uint64_t h2 = mix(h1) | 1;
+
+    for(uint32_t hash = 0; _bloom_hashes > hash; ++hash)
+    {
+        const uint64_t bit = (h1 + hash * h2) % _bloom_bits;
+
+        _bloom[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+bool DuplicateFilter::bloomContains(const Key &key) const
+{
+    const uint64_t h1 = mix((static_cast<uint64_t>(key.run) << 32 | key.lumi)
+            ^ mix(key.event));
+    const uint64_t h2 = mix(h1) | 1;
+
+    for(uint32_t hash = 0; _bloom_hashes > hash; ++hash)
+    {
+        const uint64_t bit = (h1 + hash * h2) % _bloom_bits;
+
+        if (!(_bloom[bit / 64] & (1ULL << (bit % 64))))
+            return false;
+    }
+
+    return true;
+}
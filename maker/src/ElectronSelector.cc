@@ -3,33 +3,40 @@
 // Created by Samvel Khalatyan, Oct 10, 2011
 // Copyright 2011, All rights reserved
 
-#include "DataFormats/Common/interface/Handle.h"
 #include "DataFormats/PatCandidates/interface/Electron.h"
-#include "FWCore/Framework/interface/Event.h"
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
 
 #include "bsm_input_maker/maker/interface/ElectronSelector.h"
+#include "bsm_input_maker/maker/interface/EventContext.h"
 
 using namespace bsm;
 using namespace edm;
 using namespace pat;
 
-ElectronSelector::ElectronSelector(const edm::InputTag &electron_tag):
-    Selector(electron_tag)
+ElectronSelector::ElectronSelector(const edm::InputTag &electron_tag,
+        const edm::ParameterSet &cuts):
+    Selector(electron_tag),
+    _kinematics(cuts)
 {
+    // Pt and eta cuts are applied by kinematics kernel
+    //
+    _cuts.reset(new Cuts("electron", cuts));
+    _cuts->addExternal("pt");
+    _cuts->addExternal("eta");
+    _cuts->validate();
 }
 
-bool ElectronSelector::init(const edm::Event *event)
+bool ElectronSelector::init(const EventContext &context)
 {
     _electron.clear();
 
     // Apply loose electron id and save pointers in event
     //
-    Handle<ElectronCollection> electrons;
-    event->getByLabel(tag(), electrons);
+    const ElectronCollection *electrons =
+        context.product<ElectronCollection>(tag());
 
     bool result = false;
-    if (!electrons.isValid())
+    if (!electrons)
     {
         LogWarning("ElectronSelector")
             << "failed to extract electrons. Check Input Tag: "
@@ -37,14 +44,36 @@ bool ElectronSelector::init(const edm::Event *event)
     }
     else
     {
+        _kinematics.clear();
         for(ElectronCollection::const_iterator electron = electrons->begin();
                 electrons->end() != electron;
                 ++electron)
         {
-            if (30 < electron->pt()
-                    && 2.5 > fabs(electron->eta()))
+            _kinematics.add(electron->pt(), electron->eta(),
+                    electron->phi(), electron->energy());
+        }
+
+        // Only electrons that pass kinematic cuts are accessed again
+        //
+        typedef Kinematics::Indices Indices;
+
+        const Indices &selected = _kinematics.select();
+        for(Indices::const_iterator index = selected.begin();
+                selected.end() != index;
+                ++index)
+        {
+            const pat::Electron *electron = &(*electrons)[*index];
+
+            Candidate candidate;
+            candidate.electron = electron;
+
+            if ((*_cuts)(candidate))
             {
-                _electron.push_back(&*electron);
+                candidate.super_cluster_eta = electron->superCluster()->eta();
+                candidate.inner_track_expected_hits =
+                    electron->gsfTrack()->trackerExpectedHitsInner().numberOfHits();
+
+                _electron.push_back(candidate);
             }
         }
 
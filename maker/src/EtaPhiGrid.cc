@@ -0,0 +1,165 @@
+// Eta-phi grid index for dR searches
+//
+// Created by Samvel Khalatyan, Mar 12, 2012
+// Copyright 2012, All rights reserved
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/EtaPhiGrid.h"
+
+using namespace std;
+
+using bsm::EtaPhiGrid;
+
+namespace
+{
+    const float TWO_PI = 2 * M_PI;
+}
+
+EtaPhiGrid::EtaPhiGrid(const double &cone, const bool &is_inclusive):
+    _cone(cone),
+    _cone2(cone * cone),
+    _is_inclusive(is_inclusive)
+{
+    if (0 >= cone)
+        throw cms::Exception("EtaPhiGrid")
+            << "cone should be positive: " << cone;
+
+    // Phi cells are at least cone wide
+    //
+    _phi_cells = max(static_cast<int>(TWO_PI / _cone), 1);
+    _phi_cell_size = TWO_PI / _phi_cells;
+}
+
+double EtaPhiGrid::cone() const
+{
+    return _cone;
+}
+
+void EtaPhiGrid::clear()
+{
+    _objects.clear();
+}
+
+void EtaPhiGrid::add(const uint32_t &index,
+        const float &eta,
+        const float &phi)
+{
+    Object object;
+    object.cell = cell(etaCell(eta), phiCell(phi));
+    object.index = index;
+    object.eta = eta;
+    object.phi = phi;
+
+    _objects.push_back(object);
+}
+
+void EtaPhiGrid::build()
+{
+    sort(_objects.begin(), _objects.end());
+}
+
+void EtaPhiGrid::find(const float &eta,
+        const float &phi,
+        Indices &indices) const
+{
+    indices.clear();
+
+    if (_objects.empty())
+        return;
+
+    const int eta_cell = etaCell(eta);
+    const int phi_cell = phiCell(phi);
+
+    // Neighbouring phi cells are contiguous in the row except at the wrap
+    // around: each row is scanned with one or two ranges. Less than 4 phi
+    // cells cover all phi
+    //
+    const int last_phi_cell = _phi_cells - 1;
+    for(int row = eta_cell - 1; eta_cell + 1 >= row; ++row)
+    {
+        if (3 >= _phi_cells)
+            scan(cell(row, 0), cell(row, last_phi_cell), eta, phi, indices);
+
+        else if (!phi_cell)
+        {
+            scan(cell(row, 0), cell(row, 1), eta, phi, indices);
+            scan(cell(row, last_phi_cell), cell(row, last_phi_cell),
+                    eta, phi, indices);
+        }
+        else if (last_phi_cell == phi_cell)
+        {
+            scan(cell(row, 0), cell(row, 0), eta, phi, indices);
+            scan(cell(row, phi_cell - 1), cell(row, last_phi_cell),
+                    eta, phi, indices);
+        }
+        else
+            scan(cell(row, phi_cell - 1), cell(row, phi_cell + 1),
+                    eta, phi, indices);
+    }
+
+    sort(indices.begin(), indices.end());
+}
+
+
+
+// Privates
+//
+bool EtaPhiGrid::Object::operator<(const Object &object) const
+{
+    return cell < object.cell;
+}
+
+void EtaPhiGrid::scan(const int64_t &first_cell,
+        const int64_t &last_cell,
+        const float &eta,
+        const float &phi,
+        Indices &indices) const
+{
+    Object key;
+    key.cell = first_cell;
+
+    for(Objects::const_iterator object =
+                lower_bound(_objects.begin(), _objects.end(), key);
+            _objects.end() != object
+                && last_cell >= object->cell;
+            ++object)
+    {
+        const float deta = eta - object->eta;
+
+        float dphi = fabs(phi - object->phi);
+        dphi = min(dphi, TWO_PI - dphi);
+
+        const float dr2 = deta * deta + dphi * dphi;
+        if (_cone2 > dr2
+                || (_is_inclusive && _cone2 == dr2))
+            indices.push_back(object->index);
+    }
+}
+
+int64_t EtaPhiGrid::cell(const int &eta_cell, const int &phi_cell) const
+{
+    return static_cast<int64_t>(eta_cell) * _phi_cells + phi_cell;
+}
+
+int EtaPhiGrid::etaCell(const float &eta) const
+{
+    return static_cast<int>(floor(eta / _cone));
+}
+
+int EtaPhiGrid::phiCell(const float &phi) const
+{
+    // Phi is in [-pi, pi]: shift into [0, 2pi)
+    //
+    float shifted = phi + M_PI;
+    if (0 > shifted)
+        shifted += TWO_PI;
+    else if (TWO_PI <= shifted)
+        shifted -= TWO_PI;
+
+    return min(static_cast<int>(shifted / _phi_cell_size), _phi_cells - 1);
+}
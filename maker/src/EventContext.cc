@@ -0,0 +1,101 @@
+// Per-event products shared by selectors and InputMaker
+//
+// Created by Samvel Khalatyan, Feb 27, 2012
+// Copyright 2012, All rights reserved
+
+#include "DataFormats/VertexReco/interface/Vertex.h"
+
+#include "bsm_input_maker/maker/interface/Selector.h"
+#include "bsm_input_maker/maker/interface/EventContext.h"
+
+using namespace bsm;
+using namespace edm;
+
+EventContext::EventContext(const edm::InputTag &primary_vertex_tag,
+        const edm::InputTag &rho_tag):
+    _event(0),
+    _primary_vertex_tag(primary_vertex_tag),
+    _rho_tag(rho_tag),
+    _good_primary_vertices_done(false)
+{
+}
+
+void EventContext::reset(const edm::Event &event)
+{
+    _event = &event;
+
+    for(Entries::iterator entry = _products.begin();
+            _products.end() != entry;
+            ++entry)
+    {
+        entry->is_loaded = false;
+    }
+
+    _good_primary_vertices_done = false;
+    _good_primary_vertices.clear();
+}
+
+const edm::Event &EventContext::event() const
+{
+    return *_event;
+}
+
+const edm::InputTag &EventContext::primaryVertexTag() const
+{
+    return _primary_vertex_tag;
+}
+
+const edm::InputTag &EventContext::rhoTag() const
+{
+    return _rho_tag;
+}
+
+const EventContext::PrimaryVertices *EventContext::primaryVertices() const
+{
+    return product<PrimaryVertices>(primaryVertexTag());
+}
+
+const EventContext::GoodPrimaryVertices
+    &EventContext::goodPrimaryVertices() const
+{
+    if (_good_primary_vertices_done)
+        return _good_primary_vertices;
+
+    _good_primary_vertices_done = true;
+
+    const PrimaryVertices *vertices = primaryVertices();
+    if (!vertices)
+        return _good_primary_vertices;
+
+    const bool is_real_data = _event->isRealData();
+    for(PrimaryVertices::const_iterator vertex = vertices->begin();
+            vertices->end() != vertex;
+            ++vertex)
+    {
+        if (selector::isGoodPrimaryVertex(*vertex, is_real_data))
+            _good_primary_vertices.push_back(&*vertex);
+    }
+
+    return _good_primary_vertices;
+}
+
+uint32_t EventContext::npv() const
+{
+    const PrimaryVertices *vertices = primaryVertices();
+
+    return vertices ? vertices->size() : 0;
+}
+
+const double *EventContext::rho() const
+{
+    return product<double>(rhoTag());
+}
+
+// Entry
+//
+EventContext::Entry::Entry(const edm::InputTag &tag, Holder *holder):
+    tag(tag),
+    holder(holder),
+    is_loaded(true)
+{
+}
@@ -0,0 +1,150 @@
+// Reuse event message memory between events
+//
+// Created by Samvel Khalatyan, Mar 15, 2012
+// Copyright 2012, All rights reserved
+
+#include <google/protobuf/unknown_field_set.h>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "bsm_input_maker/bsm_input/interface/Event.pb.h"
+#include "bsm_input_maker/bsm_input/interface/Trigger.pb.h"
+#include "bsm_input_maker/maker/interface/EventRecycler.h"
+
+using google::protobuf::Message;
+using google::protobuf::UnknownField;
+using google::protobuf::UnknownFieldSet;
+
+using bsm::EventRecycler;
+using edm::ParameterSet;
+
+EventRecycler::EventRecycler(const ParameterSet &config):
+    _sample_every(config.getParameter<uint32_t>("sample_every")),
+    _max_bytes(config.getParameter<uint32_t>("max_bytes")),
+    _events(0),
+    _samples(0),
+    _growths(0),
+    _trims(0),
+    _high_water(0),
+    _kept_unknown_fields(0)
+{
+}
+
+void EventRecycler::recycle(boost::shared_ptr<Event> &event)
+{
+    keep(*event);
+
+    event->Clear();
+
+    ++_events;
+
+    if (!_sample_every
+            || _events % _sample_every)
+        return;
+
+    ++_samples;
+
+    const uint64_t bytes = event->SpaceUsed();
+    if (_high_water < bytes)
+    {
+        // The first sample is the warm-up
+        //
+        if (1 < _samples)
+            ++_growths;
+
+        _high_water = bytes;
+    }
+
+    if (_max_bytes
+            && _max_bytes < bytes)
+    {
+        event.reset(new Event());
+
+        ++_trims;
+    }
+}
+
+void EventRecycler::addString(Message *message,
+        const int &field,
+        const std::string &value)
+{
+    UnknownFieldSet *fields =
+        message->GetReflection()->MutableUnknownFields(message);
+
+    if (!fields->empty()
+            || !_kept_unknown_fields)
+    {
+        fields->AddLengthDelimited(field, value);
+
+        return;
+    }
+
+    // Message gets the kept set and leaves its empty one instead
+    //
+    UnknownFieldSet &kept = *_unknown_fields[--_kept_unknown_fields];
+    if (field != kept.field(0).number())
+    {
+        ++_kept_unknown_fields;
+
+        fields->AddLengthDelimited(field, value);
+
+        return;
+    }
+
+    fields->Swap(&kept);
+    fields->mutable_field(0)->mutable_length_delimited()->assign(value);
+}
+
+uint64_t EventRecycler::events() const
+{
+    return _events;
+}
+
+uint64_t EventRecycler::samples() const
+{
+    return _samples;
+}
+
+uint64_t EventRecycler::growths() const
+{
+    return _growths;
+}
+
+uint64_t EventRecycler::trims() const
+{
+    return _trims;
+}
+
+uint64_t EventRecycler::highWater() const
+{
+    return _high_water;
+}
+
+// Privates
+//
+void EventRecycler::keep(Event &event)
+{
+    if (!event.has_hlt())
+        return;
+
+    typedef ::google::protobuf::RepeatedPtrField<TriggerFilter> Filters;
+
+    Filters *filters = event.mutable_hlt()->mutable_filter();
+    for(Filters::iterator filter = filters->begin();
+            filters->end() != filter;
+            ++filter)
+    {
+        UnknownFieldSet *fields = filter->mutable_unknown_fields();
+        if (1 != fields->field_count()
+                || UnknownField::TYPE_LENGTH_DELIMITED !=
+                    fields->field(0).type())
+            continue;
+
+        // New sets are only created until the largest event is seen
+        //
+        if (_unknown_fields.size() == _kept_unknown_fields)
+            _unknown_fields.push_back(UnknownFields(new UnknownFieldSet()));
+
+        _unknown_fields[_kept_unknown_fields++]->Swap(fields);
+    }
+}
@@ -0,0 +1,241 @@
+// Select roots of the stored gen-particle trees
+//
+// Created by Samvel Khalatyan, Mar 17, 2012
+// Copyright 2012, All rights reserved
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "DataFormats/HepMCCandidate/interface/GenParticle.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/GenParticleFilter.h"
+
+using namespace std;
+
+using bsm::GenParticleFilter;
+using edm::ParameterSet;
+
+namespace
+{
+    // Quarks, leptons, bosons and Z', W' are below the table size
+    //
+    const uint32_t PDG_ID_TABLE = 128;
+    const uint32_t STATUSES = 256;
+    const uint32_t MAX_RULES = 32;
+    const uint32_t MAX_DEPTH = 10;
+
+    typedef GenParticleFilter::Root Root;
+
+    struct SingleMatch
+    {
+        int pdg_id;
+        int status;
+
+        uint32_t operator()(const reco::GenParticle &particle) const
+        {
+            return status == particle.status()
+                && pdg_id == abs(particle.pdgId());
+        }
+    };
+
+    struct TableMatch
+    {
+        const GenParticleFilter *filter;
+
+        uint32_t operator()(const reco::GenParticle &particle) const;
+    };
+
+    int lowestBit(const uint32_t &mask)
+    {
+        return __builtin_ctz(mask);
+    }
+}
+
+GenParticleFilter::GenParticleFilter(const vector<ParameterSet> &rules):
+    _pdg_id_rules(PDG_ID_TABLE, 0),
+    _status_rules(STATUSES, 0),
+    _child_status_rules(STATUSES, 0),
+    _all_rules(0),
+    _is_single(false),
+    _single_pdg_id(0),
+    _single_status(0)
+{
+    if (MAX_RULES < rules.size())
+        throw cms::Exception("GenParticleFilter")
+            << "number of rules should be at most " << MAX_RULES << ": "
+            << rules.size();
+
+    for(size_t rule = 0; rules.size() > rule; ++rule)
+    {
+        const ParameterSet &config = rules[rule];
+        const uint32_t bit = 1u << rule;
+
+        const vector<uint32_t> pdg_ids =
+            config.getParameter<vector<uint32_t> >("pdg_ids");
+        for(vector<uint32_t>::const_iterator pdg_id = pdg_ids.begin();
+                pdg_ids.end() != pdg_id;
+                ++pdg_id)
+        {
+            if (PDG_ID_TABLE > *pdg_id)
+            {
+                _pdg_id_rules[*pdg_id] |= bit;
+
+                continue;
+            }
+
+            vector<PdgIdRules>::iterator large =
+                lower_bound(_large_pdg_id_rules.begin(),
+                        _large_pdg_id_rules.end(),
+                        PdgIdRules(*pdg_id, 0));
+            if (_large_pdg_id_rules.end() == large
+                    || *pdg_id != large->first)
+                large = _large_pdg_id_rules.insert(large,
+                        PdgIdRules(*pdg_id, 0));
+
+            large->second |= bit;
+        }
+
+        const char *status_names[] = {"statuses", "child_statuses"};
+        RuleMasks *status_tables[] = {&_status_rules, &_child_status_rules};
+        for(int table = 0; 2 > table; ++table)
+        {
+            const vector<uint32_t> statuses =
+                config.getParameter<vector<uint32_t> >(status_names[table]);
+            for(vector<uint32_t>::const_iterator status = statuses.begin();
+                    statuses.end() != status;
+                    ++status)
+            {
+                if (STATUSES <= *status)
+                    throw cms::Exception("GenParticleFilter")
+                        << "status should be below " << STATUSES << ": "
+                        << *status;
+
+                (*status_tables[table])[*status] |= bit;
+            }
+        }
+
+        _depth.push_back(min(config.getParameter<uint32_t>("depth"),
+                    MAX_DEPTH));
+        _max_roots.push_back(config.getParameter<uint32_t>("max_roots"));
+        _all_rules |= bit;
+
+        if (1 == rules.size()
+                && 1 == pdg_ids.size()
+                && 1 == config.getParameter<vector<uint32_t> >(
+                    "statuses").size())
+        {
+            _is_single = true;
+            _single_pdg_id = pdg_ids[0];
+            _single_status = config.getParameter<vector<uint32_t> >(
+                    "statuses")[0];
+        }
+    }
+
+    _found.resize(rules.size());
+}
+
+const GenParticleFilter::Roots &GenParticleFilter::roots(
+        const reco::GenParticleCollection &particles)
+{
+    _roots.clear();
+
+    if (!_all_rules)
+        return _roots;
+
+    if (_is_single)
+    {
+        SingleMatch match;
+        match.pdg_id = _single_pdg_id;
+        match.status = _single_status;
+
+        scan(particles, match);
+    }
+    else
+    {
+        TableMatch match;
+        match.filter = this;
+
+        scan(particles, match);
+    }
+
+    return _roots;
+}
+
+uint32_t GenParticleFilter::depth(const uint32_t &rule) const
+{
+    return _depth[rule];
+}
+
+bool GenParticleFilter::isChild(const uint32_t &rule, const int &status) const
+{
+    return 0 <= status
+        && STATUSES > static_cast<uint32_t>(status)
+        && (_child_status_rules[status] & (1u << rule));
+}
+
+
+
+// Privates
+//
+uint32_t GenParticleFilter::rules(const int &pdg_id, const int &status) const
+{
+    if (0 > status
+            || STATUSES <= static_cast<uint32_t>(status))
+        return 0;
+
+    const uint32_t status_rules = _status_rules[status];
+    if (!status_rules)
+        return 0;
+
+    const uint32_t abs_pdg_id = abs(pdg_id);
+    if (PDG_ID_TABLE > abs_pdg_id)
+        return status_rules & _pdg_id_rules[abs_pdg_id];
+
+    vector<PdgIdRules>::const_iterator large =
+        lower_bound(_large_pdg_id_rules.begin(),
+                _large_pdg_id_rules.end(),
+                PdgIdRules(abs_pdg_id, 0));
+
+    return _large_pdg_id_rules.end() != large
+            && abs_pdg_id == large->first
+        ? status_rules & large->second
+        : 0;
+}
+
+template<typename Match>
+    void GenParticleFilter::scan(const reco::GenParticleCollection &particles,
+            const Match &match)
+{
+    fill(_found.begin(), _found.end(), 0);
+
+    // Rules are dropped from the active mask once they have all roots
+    //
+    uint32_t active = _all_rules;
+    for(reco::GenParticleCollection::const_iterator particle =
+                particles.begin();
+            particles.end() != particle
+                && active;
+            ++particle)
+    {
+        const uint32_t mask = match(*particle) & active;
+        if (!mask)
+            continue;
+
+        Root root;
+        root.particle = &*particle;
+        root.rule = lowestBit(mask);
+
+        _roots.push_back(root);
+
+        if (_max_roots[root.rule]
+                && _max_roots[root.rule] <= ++_found[root.rule])
+            active &= ~(1u << root.rule);
+    }
+}
+
+uint32_t TableMatch::operator()(const reco::GenParticle &particle) const
+{
+    return filter->rules(particle.pdgId(), particle.status());
+}
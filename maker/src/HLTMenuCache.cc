@@ -0,0 +1,156 @@
+// Parsed HLT menus cached on disk between jobs
+//
+// Created by Samvel Khalatyan, Mar 22, 2012
+// Copyright 2012, All rights reserved
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include <boost/functional/hash.hpp>
+
+#include "bsm_input_maker/maker/interface/HLTMenuCache.h"
+
+using namespace std;
+
+using bsm::HLTMenuCache;
+
+namespace
+{
+    // Version changes if the format or names parsing change
+    //
+    const int VERSION = 2;
+
+    const string MAGIC = "bsm_hlt_menu";
+
+    string header(const string &key)
+    {
+        ostringstream out;
+        out << MAGIC << " " << VERSION << "\n"
+            << key.size() << "\n"
+            << key << "\n";
+
+        return out.str();
+    }
+}
+
+HLTMenuCache::HLTMenuCache(const string &directory):
+    _directory(directory)
+{
+}
+
+bool HLTMenuCache::load(const string &key, Menu &menu) const
+{
+    menu.clear();
+
+    ifstream in(filename(key).c_str());
+    if (!in)
+        return false;
+
+    // Key may have any characters: compare the header as is
+    //
+    const string expected_header = header(key);
+
+    string file_header(expected_header.size(), 0);
+    if (!in.read(&file_header[0], file_header.size())
+            || expected_header != file_header)
+        return false;
+
+    size_t paths = 0;
+    if (!(in >> paths))
+        return false;
+
+    menu.resize(paths);
+    for(Menu::iterator path = menu.begin(); menu.end() != path; ++path)
+    {
+        size_t filters = 0;
+        if (!(in >> path->id
+                    >> path->full_name
+                    >> path->name
+                    >> path->version
+                    >> filters))
+            break;
+
+        path->filters.resize(filters);
+        for(Filters::iterator filter = path->filters.begin();
+                path->filters.end() != filter;
+                ++filter)
+        {
+            if (!(in >> filter->label >> filter->name))
+                break;
+        }
+    }
+
+    if (!in)
+    {
+        menu.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+bool HLTMenuCache::save(const string &key, const Menu &menu) const
+{
+    const string cache_filename = filename(key);
+
+    // Jobs of the same menu may write it at the same time
+    //
+    ostringstream tmp_filename;
+    tmp_filename << cache_filename << ".tmp." << getpid();
+    {
+        ofstream out(tmp_filename.str().c_str(), ios::trunc);
+
+        out << header(key) << menu.size() << "\n";
+        for(Menu::const_iterator path = menu.begin();
+                menu.end() != path;
+                ++path)
+        {
+            out << path->id
+                << " " << path->full_name
+                << " " << path->name
+                << " " << path->version
+                << " " << path->filters.size() << "\n";
+
+            for(Filters::const_iterator filter = path->filters.begin();
+                    path->filters.end() != filter;
+                    ++filter)
+            {
+                out << " " << filter->label
+                    << " " << filter->name << "\n";
+            }
+        }
+
+        if (!out)
+        {
+            remove(tmp_filename.str().c_str());
+
+            return false;
+        }
+    }
+
+    if (rename(tmp_filename.str().c_str(), cache_filename.c_str()))
+    {
+        remove(tmp_filename.str().c_str());
+
+        return false;
+    }
+
+    return true;
+}
+
+
+
+// Privates
+//
+string HLTMenuCache::filename(const string &key) const
+{
+    ostringstream name;
+    name << _directory << "/hlt_menu_" << hex << boost::hash<string>()(key)
+        << ".txt";
+
+    return name.str();
+}
@@ -0,0 +1,176 @@
+// Control distributions filled during production
+//
+// Created by Samvel Khalatyan, Mar 9, 2012
+// Copyright 2012, All rights reserved
+
+#include <algorithm>
+
+#include <TH1D.h>
+
+#include "CommonTools/UtilAlgos/interface/TFileService.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/ServiceRegistry/interface/Service.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/Histograms.h"
+
+using namespace std;
+
+using bsm::Histograms;
+using edm::LogWarning;
+using edm::ParameterSet;
+
+namespace
+{
+    const char *STAGE_NAMES[] = {"pre", "post"};
+
+    const char *VARIABLE_NAMES[] = {
+        "jet_pt", "jet_eta",
+        "electron_pt", "electron_eta", "electron_isolation",
+        "muon_pt", "muon_eta", "muon_isolation",
+        "npv", "met", "pileup"
+    };
+
+    template<typename T>
+        T find(const string &name, const char **names, const int &size,
+                const string &what)
+    {
+        for(int index = 0; size > index; ++index)
+        {
+            if (name == names[index])
+                return static_cast<T>(index);
+        }
+
+        throw cms::Exception("Histograms")
+            << "unknown " << what << ": " << name;
+    }
+}
+
+Histograms::Histograms(const vector<ParameterSet> &config)
+{
+    for(vector<ParameterSet>::const_iterator histogram = config.begin();
+            config.end() != histogram;
+            ++histogram)
+    {
+        Histogram new_histogram;
+        new_histogram.name = histogram->getParameter<string>("name");
+        new_histogram.stage = find<Stage>(
+                histogram->getParameter<string>("stage"),
+                STAGE_NAMES, STAGES, "stage");
+        new_histogram.variable = find<Variable>(
+                histogram->getParameter<string>("variable"),
+                VARIABLE_NAMES, VARIABLES, "variable");
+
+        const uint32_t bins = histogram->getParameter<uint32_t>("bins");
+        new_histogram.min = histogram->getParameter<double>("min");
+        new_histogram.max = histogram->getParameter<double>("max");
+
+        if (!bins
+                || new_histogram.min >= new_histogram.max)
+            throw cms::Exception("Histograms")
+                << "bad binning of " << new_histogram.name;
+
+        new_histogram.scale = bins / (new_histogram.max - new_histogram.min);
+        new_histogram.bins.assign(bins + 2, 0);
+        new_histogram.entries = 0;
+
+        _used[new_histogram.stage][new_histogram.variable].push_back(
+                _histograms.size());
+        _histograms.push_back(new_histogram);
+    }
+}
+
+bool Histograms::isUsed(const Stage &stage, const Variable &variable) const
+{
+    return !_used[stage][variable].empty();
+}
+
+bool Histograms::isUsed(const Stage &stage) const
+{
+    for(int variable = 0; VARIABLES > variable; ++variable)
+    {
+        if (!_used[stage][variable].empty())
+            return true;
+    }
+
+    return false;
+}
+
+void Histograms::fill(const Stage &stage,
+        const Variable &variable,
+        const double &value)
+{
+    const Indices &indices = _used[stage][variable];
+    for(Indices::const_iterator index = indices.begin();
+            indices.end() != index;
+            ++index)
+    {
+        _histograms[*index].fill(value);
+    }
+}
+
+void Histograms::write() const
+{
+    if (_histograms.empty())
+        return;
+
+    edm::Service<TFileService> file_service;
+    if (!file_service.isAvailable())
+    {
+        LogWarning("Histograms")
+            << "TFileService is not available: histograms are not saved";
+
+        return;
+    }
+
+    TFileDirectory directories[] = {
+        file_service->mkdir(STAGE_NAMES[PRE]),
+        file_service->mkdir(STAGE_NAMES[POST])
+    };
+
+    for(Collection::const_iterator histogram = _histograms.begin();
+            _histograms.end() != histogram;
+            ++histogram)
+    {
+        const int bins = histogram->bins.size() - 2;
+
+        TH1D *root_histogram = directories[histogram->stage].make<TH1D>(
+                histogram->name.c_str(),
+                VARIABLE_NAMES[histogram->variable],
+                bins, histogram->min, histogram->max);
+
+        // ROOT keeps underflow in bin 0 and overflow in bins + 1
+        //
+        for(int bin = 0; bins + 2 > bin; ++bin)
+            root_histogram->SetBinContent(bin, histogram->bins[bin]);
+
+        root_histogram->SetEntries(histogram->entries);
+    }
+}
+
+
+
+// Privates
+//
+void Histograms::Histogram::fill(const double &value)
+{
+    ++entries;
+
+    // NaN is counted in underflow
+    //
+    if (!(min <= value))
+        ++bins.front();
+
+    else if (max <= value)
+        ++bins.back();
+
+    else
+    {
+        // Bin index is computed directly: no search in fixed binning
+        //
+        const size_t bin = 1 + static_cast<size_t>((value - min) * scale);
+
+        ++bins[std::min(bin, bins.size() - 2)];
+    }
+}
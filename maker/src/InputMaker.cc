@@ -4,7 +4,10 @@
 // Copyright 2011, All rights reserved
 
 #include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -25,9 +28,12 @@
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/VertexReco/interface/Vertex.h"
 #include "FWCore/Framework/interface/Event.h"
+#include "FWCore/Framework/interface/LuminosityBlock.h"
 #include "FWCore/Framework/interface/MakerMacros.h"
 #include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/MessageLogger/interface/JobReport.h"
 #include "FWCore/ServiceRegistry/interface/Service.h"
+#include "FWCore/Utilities/interface/Exception.h"
 #include "FWCore/Utilities/interface/InputTag.h"
 #include "HLTrigger/HLTcore/interface/HLTConfigProvider.h"
 #include "PhysicsTools/SelectorUtils/interface/SimpleCutBasedElectronIDSelectionFunctor.h"
@@ -39,9 +45,21 @@
 #include "bsm_input_maker/bsm_input/interface/Track.pb.h"
 #include "bsm_input_maker/bsm_input/interface/Trigger.pb.h"
 #include "bsm_input_maker/maker/interface/Selector.h"
+#include "bsm_input_maker/maker/interface/ByteBudget.h"
+#include "bsm_input_maker/maker/interface/Checkpoint.h"
+#include "bsm_input_maker/maker/interface/DuplicateFilter.h"
 #include "bsm_input_maker/maker/interface/ElectronSelector.h"
+#include "bsm_input_maker/maker/interface/EventContext.h"
+#include "bsm_input_maker/maker/interface/EventRecycler.h"
+#include "bsm_input_maker/maker/interface/ExtraFields.h"
+#include "bsm_input_maker/maker/interface/GenParticleFilter.h"
+#include "bsm_input_maker/maker/interface/HLTMenuCache.h"
 #include "bsm_input_maker/maker/interface/JetSelector.h"
+#include "bsm_input_maker/maker/interface/LumiMask.h"
+#include "bsm_input_maker/maker/interface/LumiSummary.h"
 #include "bsm_input_maker/maker/interface/MuonSelector.h"
+#include "bsm_input_maker/maker/interface/TriggerFilterKeys.h"
+#include "bsm_input_maker/maker/interface/TtbarHypotheses.h"
 #include "bsm_input_maker/maker/interface/Utility.h"
 
 #include "bsm_input_maker/maker/interface/InputMaker.h"
@@ -55,33 +73,117 @@ using bsm::InputMaker;
 
 static void set_electronid(bsm::Electron *, bsm::Electron::ElectronIDName const, int const);
 
+namespace
+{
+    // Relative combined isolation with the same inputs as stored in output
+    //
+    double isolation(const pat::Electron &electron)
+    {
+        return (electron.dr03TkSumPt()
+                + electron.dr03EcalRecHitSumEt()
+                + electron.dr03HcalTowerSumEt()) / electron.pt();
+    }
+
+    double isolation(const pat::Muon &muon)
+    {
+        return (muon.trackIso() + muon.ecalIso() + muon.hcalIso()) / muon.pt();
+    }
+
+    // Return false if direction is not defined
+    //
+    bool direction(const bsm::LorentzVector &p4, float &eta, float &phi)
+    {
+        const double pt = hypot(p4.px(), p4.py());
+        if (!pt)
+            return false;
+
+        eta = asinh(p4.pz() / pt);
+        phi = atan2(p4.py(), p4.px());
+
+        return true;
+    }
+}
+
 InputMaker::InputMaker(const ParameterSet &config):
-    _input_type(Input::UNKNOWN)
+    _input_type(Input::UNKNOWN),
+    _is_lumi_certified(true),
+    _rejected_lumis(0),
+    _rejected_events(0),
+    _main_channels(0)
 {
     GOOGLE_PROTOBUF_VERIFY_VERSION;
 
     _event.reset(new Event());
+    _event_recycler.reset(new EventRecycler(
+                config.getParameter<ParameterSet>("event_recycling")));
+
+    const ParameterSet byte_budget =
+        config.getParameter<ParameterSet>("byte_budget");
+    _byte_budget.reset(new ByteBudget(byte_budget));
+    _byte_budget_filename = byte_budget.getParameter<string>("json_filename");
     _hlt_config.reset(new HLTConfigProvider());
 
     _pileup_tag = config.getParameter<InputTag>("pileup");
 
     _gen_particle_tag = config.getParameter<InputTag>("gen_particle");
-    _gen_particle_depth_level =
-        std::min(config.getParameter<uint32_t>("gen_particle_depth_level"),
-            static_cast<uint32_t>(10));
+    _gen_particle_filter.reset(new GenParticleFilter(
+                config.getParameter<vector<ParameterSet> >("gen_particle_trees")));
+    _gen_parton_by_index = config.getParameter<bool>("gen_parton_by_index");
     _rho_tag = config.getParameter<InputTag>("rho");
 
     _primary_vertex_tag = config.getParameter<InputTag>("primary_vertex");
+    _event_context.reset(new EventContext(_primary_vertex_tag, _rho_tag));
+
+    const ParameterSet primary_vertex_storage =
+        config.getParameter<ParameterSet>("primary_vertex_storage");
+    setPrimaryVertexStorage(
+            primary_vertex_storage.getParameter<string>("mode"));
+    _primary_vertex_limit =
+        primary_vertex_storage.getParameter<uint32_t>("max_vertices");
     _missing_energy_tag = config.getParameter<InputTag>("missing_energy");
 
     _electron_selector.reset(new ElectronSelector(
-                config.getParameter<InputTag>("electron")));
+                config.getParameter<InputTag>("electron"),
+                config.getParameter<ParameterSet>("electron_selection")));
+
+    // Electron IDs of the MC tune
+    //
+    const string postfix = "MC";
+    _electron_ids.push_back(ElectronID(bsm::Electron::VeryLoose,
+                "eidVeryLoose" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::Loose,
+                "eidLoose" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::Medium,
+                "eidMedium" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::Tight,
+                "eidTight" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::SuperTight,
+                "eidSuperTight" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::HyperTight1,
+                "eidHyperTight1" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::HyperTight2,
+                "eidHyperTight2" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::HyperTight3,
+                "eidHyperTight3" + postfix));
+    _electron_ids.push_back(ElectronID(bsm::Electron::HyperTight4,
+                "eidHyperTight4" + postfix));
+
     _muon_selector.reset(new MuonSelector(
-                config.getParameter<InputTag>("muon"), _primary_vertex_tag));
+                config.getParameter<InputTag>("muon"),
+                config.getParameter<ParameterSet>("muon_selection")));
     _jet_selector.reset(new JetSelector(config.getParameter<InputTag>("jet"),
-            _primary_vertex_tag,
-            _rho_tag,
-            config.getParameter<vector<string> >("jec")));
+            config.getParameter<ParameterSet>("jet_selection"),
+            config.getParameter<vector<string> >("jec"),
+            config.getParameter<double>("jet_lepton_cone")));
+    _jet_selector->useJECGrid(config.getParameter<uint32_t>("jec_grid_points"),
+            config.getParameter<double>("jec_grid_tolerance"));
+    _jet_selector->useSystematics(
+            config.getParameter<ParameterSet>("jet_systematics"));
+
+    const ParameterSet ttbar_hypotheses =
+        config.getParameter<ParameterSet>("ttbar_hypotheses");
+    if (ttbar_hypotheses.getParameter<bool>("enable"))
+        _ttbar_hypotheses.reset(new TtbarHypotheses(ttbar_hypotheses));
 
     _trigger_results_tag = config.getParameter<InputTag>("hlt");
     _trigger_event_tag = config.getParameter<InputTag>("trigger_event");
@@ -95,35 +197,267 @@ InputMaker::InputMaker(const ParameterSet &config):
     _hlt_filter_pattern = regex(config.getParameter<string>("hlt_filter_pattern"),
             regex_constants::icase | regex_constants::perl);
 
+    const string hlt_menu_cache = config.getParameter<string>("hlt_menu_cache");
+    if (!hlt_menu_cache.empty())
+        _hlt_menu_cache.reset(new HLTMenuCache(hlt_menu_cache));
+
+    const string trigger_filter_keys =
+        config.getParameter<string>("trigger_filter_keys");
+    if ("compact" == trigger_filter_keys)
+        _trigger_filter_encoder.reset(new TriggerFilterKeys());
+    else if ("plain" != trigger_filter_keys)
+        throw cms::Exception("InputMaker")
+            << "unsupported trigger filter keys storage: "
+            << trigger_filter_keys;
+
+    const ParameterSet trigger_matching =
+        config.getParameter<ParameterSet>("trigger_matching");
+    const char *match_objects[] = {"electron", "muon", "jet"};
+    for(int object = 0; MATCH_OBJECTS > object; ++object)
+    {
+        const string name = match_objects[object];
+        const vector<string> filters =
+            trigger_matching.getParameter<vector<string> >(name + "_filters");
+
+        TriggerMatching &matching = _trigger_matching[object];
+        for(vector<string>::const_iterator filter = filters.begin();
+                filters.end() != filter;
+                ++filter)
+        {
+            matching.filters.push_back(regex(*filter,
+                        regex_constants::icase | regex_constants::perl));
+        }
+
+        matching.grid.reset(new EtaPhiGrid(
+                    trigger_matching.getParameter<double>(name + "_cone"),
+                    false));
+    }
+
     setInputType(config.getParameter<string>("input_type"));
 
-    _writer.reset(new Writer(config.getParameter<string>("output_filename")));
-    _writer->setDelegate(this);
-    _writer->open();
+    const string lumi_mask = config.getParameter<string>("lumi_mask");
+    if (!lumi_mask.empty())
+    {
+        _lumi_mask.reset(new LumiMask(lumi_mask));
+
+        LogInfo("InputMaker") << "Load lumi mask: " << lumi_mask
+            << " [" << _lumi_mask->runs() << " runs, "
+            << _lumi_mask->intervals() << " intervals]";
+    }
+
+    const ParameterSet checkpoint =
+        config.getParameter<ParameterSet>("checkpoint");
+    if (!checkpoint.getParameter<string>("journal_filename").empty())
+    {
+        // Lumi summary and histograms of the failed attempt are not
+        // journaled: events skipped on resume would be missing in them
+        //
+        if (checkpoint.getParameter<bool>("resume")
+                && (!config.getParameter<string>("lumi_summary").empty()
+                    || !config.getParameter<vector<ParameterSet> >(
+                        "histograms").empty()))
+            throw cms::Exception("InputMaker")
+                << "lumi summary and histograms can not be used with "
+                << "checkpoint resume";
+
+        _checkpoint.reset(new Checkpoint(checkpoint));
+    }
+
+    const ParameterSet duplicate_filter =
+        config.getParameter<ParameterSet>("duplicate_filter");
+    if (duplicate_filter.getParameter<bool>("enable"))
+    {
+        _duplicate_filter.reset(new DuplicateFilter(duplicate_filter));
+
+        // Events written by the previous attempt are skipped before the
+        // duplicate filter: they are added as if written in this job
+        //
+        if (_checkpoint)
+        {
+            const Checkpoint::Keys &written = _checkpoint->written();
+            for(Checkpoint::Keys::const_iterator key = written.begin();
+                    written.end() != key;
+                    ++key)
+            {
+                _duplicate_filter->seed(key->run, key->lumi, key->event);
+            }
+        }
+    }
+
+    typedef vector<ParameterSet> ChannelsConfig;
+
+    const ChannelsConfig channels =
+        config.getParameter<ChannelsConfig>("channels");
+    if (channels.empty()
+            || 32 < channels.size())
+        throw cms::Exception("InputMaker")
+            << "number of channels should be in [1, 32]: "
+            << channels.size();
+
+    for(ChannelsConfig::const_iterator channel = channels.begin();
+            channels.end() != channel;
+            ++channel)
+    {
+        _channels.push_back(Channel(*channel));
+
+        if (_channels.back().outputFilename().empty())
+            _main_channels |= 1u << (_channels.size() - 1);
+    }
+
+    LumiSummary::Channels channel_names;
+    for(Channels::const_iterator channel = _channels.begin();
+            _channels.end() != channel;
+            ++channel)
+    {
+        channel_names.push_back(channel->name());
+    }
+
+    _lumi_summary.reset(new LumiSummary(channel_names));
+    _lumi_summary_filename = config.getParameter<string>("lumi_summary");
+
+    _histograms.reset(new Histograms(
+                config.getParameter<vector<ParameterSet> >("histograms")));
+
+    _output_filename = config.getParameter<string>("output_filename");
+
+    openWriters();
 }
 
 InputMaker::~InputMaker()
 {
     _event.reset();
+    _writers.clear();
     _writer.reset();
+    _channel_writers.clear();
 
     google::protobuf::ShutdownProtobufLibrary();
 }
 
+void InputMaker::openWriters()
+{
+    // Output is split into parts if checkpoints are used. Main stream is
+    // opened only if any channel is written into it
+    //
+    _writers.clear();
+
+    if (_main_channels)
+    {
+        _writer.reset(new Writer(_checkpoint
+                    ? _checkpoint->partFilename(_output_filename)
+                    : _output_filename));
+        _writer->setDelegate(this);
+        _writer->open();
+
+        _writers.push_back(_writer);
+    }
+
+    _channel_writers.assign(_channels.size(), boost::shared_ptr<Writer>());
+    for(size_t channel = 0; _channels.size() > channel; ++channel)
+    {
+        const string &filename = _channels[channel].outputFilename();
+        if (filename.empty())
+            continue;
+
+        boost::shared_ptr<Writer> &writer = _channel_writers[channel];
+        writer.reset(new Writer(_checkpoint
+                    ? _checkpoint->partFilename(filename)
+                    : filename));
+        writer->setDelegate(this);
+        writer->open();
+
+        _writers.push_back(writer);
+    }
+}
+
+bool InputMaker::isWriterOpen() const
+{
+    for(Writers::const_iterator writer = _writers.begin();
+            _writers.end() != writer;
+            ++writer)
+    {
+        if ((*writer)->isOpen())
+            return true;
+    }
+
+    return false;
+}
+
+void InputMaker::closeWriters()
+{
+    // Files are completed when writers are destroyed
+    //
+    _writers.clear();
+    _writer.reset();
+
+    for(Writers::iterator writer = _channel_writers.begin();
+            _channel_writers.end() != writer;
+            ++writer)
+    {
+        writer->reset();
+    }
+}
+
 void InputMaker::fileDidOpen(const bsm::Writer *writer)
 {
     using namespace posix_time;
     using namespace gregorian;
 
-    if (writer != _writer.get())
+    // Delegate receives const writer: find the stream to modify its input
+    //
+    Writer *stream = 0;
+    if (writer == _writer.get())
+        stream = _writer.get();
+    else
+    {
+        for(Writers::const_iterator channel_writer = _channel_writers.begin();
+                _channel_writers.end() != channel_writer;
+                ++channel_writer)
+        {
+            if (writer == channel_writer->get())
+            {
+                stream = channel_writer->get();
+
+                break;
+            }
+        }
+    }
+
+    if (!stream)
         return;
 
-    _writer->input()->set_type(_input_type);
+    bsm::Input *input = stream->input();
+
+    input->set_type(_input_type);
 
     ptime now_utc = second_clock::universal_time();
     ptime epoch(date(1970, 1, 1));
 
-    _writer->input()->set_create_date((now_utc - epoch).total_seconds());
+    input->set_create_date((now_utc - epoch).total_seconds());
+
+    // Channel names in the order of the event channel bits
+    //
+    for(Channels::const_iterator channel = _channels.begin();
+            _channels.end() != channel;
+            ++channel)
+    {
+        utility::addString(input, extra_field::INPUT_CHANNEL, channel->name());
+    }
+
+    // Jet variations are stored only if systematics are evaluated
+    //
+    const JetSelector::Variations &variations = _jet_selector->variations();
+    if (1 < variations.size())
+    {
+        for(JetSelector::Variations::const_iterator variation =
+                    variations.begin();
+                variations.end() != variation;
+                ++variation)
+        {
+            utility::addString(input,
+                    extra_field::INPUT_JET_VARIATION,
+                    *variation);
+        }
+    }
 }
 
 
@@ -162,54 +496,232 @@ void InputMaker::setInputType(string type)
         _input_type = Input::UNKNOWN;
 }
 
+void InputMaker::setPrimaryVertexStorage(string mode)
+{
+    to_lower(mode);
+
+    if ("all" == mode)
+        _primary_vertex_storage = PV_ALL;
+
+    else if ("good" == mode)
+        _primary_vertex_storage = PV_GOOD;
+
+    else if ("first" == mode)
+        _primary_vertex_storage = PV_FIRST;
+
+    else
+        throw cms::Exception("InputMaker")
+            << "unknown primary vertex storage mode: " << mode;
+}
+
 void InputMaker::beginRun(const Run &run, const EventSetup &setup)
 {
     initHLT(run, setup);
 }
 
+void InputMaker::beginLuminosityBlock(const LuminosityBlock &lumi,
+        const EventSetup &)
+{
+    _lumi_summary->beginLumi(lumi.run(), lumi.luminosityBlock());
+
+    if (!_lumi_mask)
+        return;
+
+    _is_lumi_certified = _lumi_mask->accept(lumi.run(),
+            lumi.luminosityBlock());
+
+    if (!_is_lumi_certified)
+        ++_rejected_lumis;
+}
+
 void InputMaker::analyze(const edm::Event &event,
                         const edm::EventSetup &setup)
 {
-    _event->Clear();
+    _lumi_summary->pass(LumiSummary::SEEN);
+
+    if (!_is_lumi_certified)
+    {
+        ++_rejected_events;
+
+        return;
+    }
+
+    _lumi_summary->pass(LumiSummary::CERTIFIED);
 
-    if (!_writer->isOpen())
+    // Event is cleared only here: events that stop early leave partial
+    // content that is reset by the next call
+    //
+    _event_recycler->recycle(_event);
+
+    if (!isWriterOpen())
+        return;
+
+    const EventID &id = event.id();
+
+    // Events written by the previous attempt of the job are skipped
+    //
+    if (_checkpoint
+            && _checkpoint->isWritten(id.run(),
+                id.luminosityBlock(),
+                id.event()))
+        return;
+
+    if (_duplicate_filter
+            && _duplicate_filter->isDuplicate(id.run(),
+                id.luminosityBlock(),
+                id.event()))
         return;
 
-    if (!triggers(event, setup)
-            || !electron(event)
-            || !muon(event)
-            || !jet(event))
+    _lumi_summary->pass(LumiSummary::UNIQUE);
+
+    // All products are extracted from the event at most once
+    //
+    _event_context->reset(event);
+    const EventContext &context = *_event_context;
+
+    countPileUp(context);
+    fillHistograms(Histograms::PRE, context);
+
+    if (!triggers(context))
+        return;
+
+    _lumi_summary->pass(LumiSummary::TRIGGER);
+
+    // All channels are evaluated on the same selectors results
+    //
+    uint32_t jet_variations = 0;
+    const uint32_t channels = select(context, jet_variations);
+    if (!channels)
         return;
 
+    _lumi_summary->pass(LumiSummary::SELECTED);
+    _lumi_summary->passChannels(channels);
+
+    utility::addVarint(_event.get(), extra_field::EVENT_CHANNELS, channels);
+
+    // Gen-particles are stored before jets to resolve the partons indices
+    //
+    genParticle(context);
+
+    electron();
+    muon();
+    jet(jet_variations);
+
+    ttbarHypotheses(context);
+
+    matchTriggers();
+
     // Set event ID
     //
-    _event->mutable_extra()->set_id(event.id().event());
-    _event->mutable_extra()->set_run(event.id().run());
-    _event->mutable_extra()->set_lumi(event.id().luminosityBlock());
+    _event->mutable_extra()->set_id(id.event());
+    _event->mutable_extra()->set_run(id.run());
+    _event->mutable_extra()->set_lumi(id.luminosityBlock());
 
     // Jet RHO
     //
     if (!_rho_tag.label().empty())
     {
-        Handle<double> rho;
-        event.getByLabel(_rho_tag, rho);
+        const double *rho = context.rho();
 
-        if (rho.isValid())
+        if (rho)
             _event->mutable_extra()->set_rho(*rho);
         else
             LogWarning("InputMaker") << "failed to extract rho";
     }
 
-    pileUp(event);
+    pileUp(context);
+
+    primaryVertex(context);
+    met(context);
+
+    if (_byte_budget->isEnabled())
+        _byte_budget->sample(*_event);
+
+    write(channels);
+
+    fillHistograms(Histograms::POST, context);
+
+    if (_duplicate_filter)
+        _duplicate_filter->insert(id.run(), id.luminosityBlock(), id.event());
+
+    // Part files are completed before the checkpoint: journaled events are
+    // never lost with unflushed output
+    //
+    if (_checkpoint)
+    {
+        _checkpoint->add(id.run(), id.luminosityBlock(), id.event());
+
+        if (_checkpoint->isDue())
+        {
+            closeWriters();
+            _checkpoint->checkpoint();
+            openWriters();
+        }
+    }
+}
+
+void InputMaker::endJob()
+{
+    _histograms->write();
+
+    if (!_lumi_summary_filename.empty()
+            && !_lumi_summary->write(_lumi_summary_filename))
+        LogWarning("InputMaker")
+            << "failed to write lumi summary: " << _lumi_summary_filename;
+
+    LogInfo("InputMaker") << "Event recycling: "
+        << _event_recycler->events() << " events, "
+        << _event_recycler->samples() << " samples, "
+        << _event_recycler->growths() << " growths, "
+        << _event_recycler->trims() << " trims, high-water "
+        << _event_recycler->highWater() << " bytes";
+
+    map<string, string> recycling;
+    recycling["Events"] = lexical_cast<string>(_event_recycler->events());
+    recycling["Samples"] = lexical_cast<string>(_event_recycler->samples());
+    recycling["Growths"] = lexical_cast<string>(_event_recycler->growths());
+    recycling["Trims"] = lexical_cast<string>(_event_recycler->trims());
+    recycling["HighWaterBytes"] =
+        lexical_cast<string>(_event_recycler->highWater());
+
+    Service<JobReport>()->reportPerformanceSummary("EventRecycling",
+            recycling);
+
+    if (_byte_budget->isEnabled())
+    {
+        ostringstream report;
+        _byte_budget->report(report);
+
+        LogInfo("InputMaker") << report.str();
+
+        if (!_byte_budget_filename.empty()
+                && !_byte_budget->write(_byte_budget_filename))
+            LogWarning("InputMaker")
+                << "failed to write byte budget: " << _byte_budget_filename;
+    }
+
+    if (_checkpoint)
+    {
+        closeWriters();
+        _checkpoint->checkpoint();
+
+        LogInfo("InputMaker") << "Checkpoint: " << _checkpoint->restored()
+            << " events restored, " << _checkpoint->skipped()
+            << " skipped, " << _checkpoint->dropped()
+            << " dropped with incomplete block";
+    }
 
-    genParticle(event);
+    if (!_lumi_mask)
+        return;
 
-    primaryVertex(event);
-    met(event);
+    LogInfo("InputMaker") << "Lumi mask rejected " << _rejected_lumis
+        << " lumis, " << _rejected_events << " events";
 
-    _writer->write(_event);
+    map<string, string> metrics;
+    metrics["RejectedLumis"] = lexical_cast<string>(_rejected_lumis);
+    metrics["RejectedEvents"] = lexical_cast<string>(_rejected_events);
 
-    _event->Clear();
+    Service<JobReport>()->reportPerformanceSummary("LumiMask", metrics);
 }
 
 void InputMaker::initHLT(const edm::Run &run, const edm::EventSetup &setup)
@@ -229,6 +741,8 @@ void InputMaker::initHLT(const edm::Run &run, const edm::EventSetup &setup)
             << "failed to initialize HLT Config Provider";
 
         _hlts.clear();
+        _hlt_filters.clear();
+        _hlt_filter_indices.clear();
 
         return;
     }
@@ -242,6 +756,18 @@ void InputMaker::initHLT(const edm::Run &run, const edm::EventSetup &setup)
     // HLT Config has changed prepare for reading a new Menu
     //
     _hlts.clear();
+    _hlt_filters.clear();
+    _hlt_filter_indices.clear();
+
+    const string menu_key = hltMenuKey();
+    if (_hlt_menu_cache
+            && loadHLTMenu(menu_key))
+    {
+        LogInfo("InputMaker") << "HLT menu " << _hlt_config->tableName()
+            << " is loaded from cache";
+
+        return;
+    }
 
     typedef std::vector<std::string> Names;
 
@@ -296,28 +822,197 @@ void InputMaker::initHLT(const edm::Run &run, const edm::EventSetup &setup)
             ? lexical_cast<uint32_t>(matches[2])
             : 1;
 
+        const Names &modules = _hlt_config->moduleLabels(cmssw_id);
+        for(Names::const_iterator module = modules.begin();
+                modules.end() != module;
+                ++module)
+        {
+            const uint32_t filter = hltFilter(*module);
+            if (_hlt_filters[filter].is_saved)
+                obj.filters.push_back(filter);
+        }
+
         _hlts[cmssw_id] = obj;
+
+        _lumi_summary->addTrigger(obj.hash, obj.name);
+    }
+
+    if (_hlt_menu_cache)
+        saveHLTMenu(menu_key);
+}
+
+string InputMaker::hltMenuKey() const
+{
+    ostringstream key;
+    key << _hlt_config->tableName() << "\n"
+        << _trigger_results_tag.process() << "\n"
+        << _hlt_path_pattern.str() << "\n"
+        << _hlt_filter_pattern.str();
+
+    return key.str();
+}
+
+bool InputMaker::loadHLTMenu(const string &key)
+{
+    HLTMenuCache::Menu menu;
+    if (!_hlt_menu_cache->load(key, menu))
+        return false;
+
+    // Hashes are computed by this build the same way as in initHLT
+    //
+    hash<string> make_hash;
+
+    for(HLTMenuCache::Menu::const_iterator path = menu.begin();
+            menu.end() != path;
+            ++path)
+    {
+        Trigger &obj = _hlts[path->id];
+        obj.full_name = path->full_name;
+        obj.name = path->name;
+        obj.hash = make_hash(obj.name);
+        obj.version = path->version;
+
+        for(HLTMenuCache::Filters::const_iterator filter =
+                    path->filters.begin();
+                path->filters.end() != filter;
+                ++filter)
+        {
+            // Filters may be shared by paths
+            //
+            const HLTFilterIndices::const_iterator index =
+                _hlt_filter_indices.find(filter->label);
+            if (_hlt_filter_indices.end() != index)
+            {
+                obj.filters.push_back(index->second);
+
+                continue;
+            }
+
+            HLTFilter hlt_filter;
+            hlt_filter.full_name = filter->label;
+            hlt_filter.name = filter->name;
+            hlt_filter.hash = make_hash(hlt_filter.name);
+            hlt_filter.is_saved = true;
+            hlt_filter.matching = triggerMatching(hlt_filter.name);
+
+            _hlt_filter_indices[filter->label] = _hlt_filters.size();
+            obj.filters.push_back(_hlt_filters.size());
+
+            _hlt_filters.push_back(hlt_filter);
+        }
+
+        _lumi_summary->addTrigger(obj.hash, obj.name);
+    }
+
+    return true;
+}
+
+void InputMaker::saveHLTMenu(const string &key) const
+{
+    HLTMenuCache::Menu menu;
+    for(Triggers::const_iterator hlt = _hlts.begin();
+            _hlts.end() != hlt;
+            ++hlt)
+    {
+        menu.push_back(HLTMenuCache::Path());
+
+        HLTMenuCache::Path &path = menu.back();
+        path.id = hlt->first;
+        path.full_name = hlt->second.full_name;
+        path.name = hlt->second.name;
+        path.version = hlt->second.version;
+
+        for(vector<uint32_t>::const_iterator filter =
+                    hlt->second.filters.begin();
+                hlt->second.filters.end() != filter;
+                ++filter)
+        {
+            const HLTFilter &hlt_filter = _hlt_filters[*filter];
+
+            HLTMenuCache::Filter cache_filter;
+            cache_filter.label = hlt_filter.full_name;
+            cache_filter.name = hlt_filter.name;
+
+            path.filters.push_back(cache_filter);
+        }
+    }
+
+    if (!_hlt_menu_cache->save(key, menu))
+        LogWarning("InputMaker") << "failed to cache HLT menu "
+            << _hlt_config->tableName();
+}
+
+uint32_t InputMaker::hltFilter(const string &label)
+{
+    const HLTFilterIndices::const_iterator index =
+        _hlt_filter_indices.find(label);
+    if (_hlt_filter_indices.end() != index)
+        return index->second;
+
+    HLTFilter hlt_filter;
+    hlt_filter.full_name = label;
+    hlt_filter.is_saved = regex_search(label, _hlt_filter_pattern);
+
+    // Filter names are saved in lower case
+    //
+    hlt_filter.name = label;
+    to_lower(hlt_filter.name);
+
+    hlt_filter.hash = hash<string>()(hlt_filter.name);
+    hlt_filter.matching = hlt_filter.is_saved
+        ? triggerMatching(hlt_filter.name)
+        : 0;
+
+    const uint32_t filter = _hlt_filters.size();
+
+    _hlt_filter_indices[label] = filter;
+    _hlt_filters.push_back(hlt_filter);
+
+    return filter;
+}
+
+uint32_t InputMaker::triggerMatching(const string &filter_name) const
+{
+    uint32_t matching = 0;
+    for(int object = 0; MATCH_OBJECTS > object; ++object)
+    {
+        const vector<regex> &patterns = _trigger_matching[object].filters;
+        for(vector<regex>::const_iterator pattern = patterns.begin();
+                patterns.end() != pattern;
+                ++pattern)
+        {
+            if (regex_search(filter_name, *pattern))
+            {
+                matching |= 1u << object;
+
+                break;
+            }
+        }
     }
+
+    return matching;
 }
 
-bool InputMaker::triggers(const edm::Event &event,
-        const edm::EventSetup &setup)
+bool InputMaker::triggers(const EventContext &context)
 {
+    for(int object = 0; MATCH_OBJECTS > object; ++object)
+        _trigger_matching[object].event_filters.clear();
+
     if (_trigger_results_tag.label().empty()
             || _hlts.empty())
         return true;
 
     // Save trigger info for the events that pass BSM PAT path
     //
-    if (!event.triggerResultsByName("PAT").accept("p0"))
+    if (!context.event().triggerResultsByName("PAT").accept("p0"))
         return false;
 
     // Extract Trigger Results and Event from the event
     //
-    Handle<TriggerResults> trigger_results;
-    event.getByLabel(_trigger_results_tag, trigger_results);
+    const TriggerResults *trigger_results =
+        context.product<TriggerResults>(_trigger_results_tag);
 
-    if (!trigger_results.isValid())
+    if (!trigger_results)
     {
         LogWarning("InputMaker")
             << "failed to extract HLTs";
@@ -325,10 +1020,10 @@ bool InputMaker::triggers(const edm::Event &event,
         return false;
     }
 
-    Handle<trigger::TriggerEvent> trigger_event;
-    event.getByLabel(_trigger_event_tag, trigger_event);
+    const trigger::TriggerEvent *trigger_event =
+        context.product<trigger::TriggerEvent>(_trigger_event_tag);
 
-    if (!trigger_event.isValid())
+    if (!trigger_event)
     {
         LogWarning("InputMaker")
             << "failed to extract Trigger Event";
@@ -336,19 +1031,10 @@ bool InputMaker::triggers(const edm::Event &event,
         return false;
     }
 
-    // Map object keys: CMSSW Key <-> ProtoBuf Key
+    // Map object keys: CMSSW Key -> ProtoBuf Key
     // Not all producers, filters and trigger objects are saved
     //
-    typedef map<uint32_t, uint32_t> MapID;
-
-    MapID object_map;
-    MapID producer_map;
-
-    // Map String to ProtoBuf ID
-    //
-    typedef map<string, uint32_t> MapNameToId;
-
-    MapNameToId filter_map;
+    const uint32_t NOT_SAVED = static_cast<uint32_t>(-1);
 
     // String to Hash convertion function
     //
@@ -364,6 +1050,8 @@ bool InputMaker::triggers(const edm::Event &event,
     const trigger::TriggerObjectCollection &objects =
         trigger_event->getObjects();
 
+    _trigger_object_map.assign(objects.size(), NOT_SAVED);
+
     // Trigger Object keys associated with producers
     //
     const trigger::Keys &keys = trigger_event->collectionKeys();
@@ -395,18 +1083,16 @@ bool InputMaker::triggers(const edm::Event &event,
         {
             // Store key in map
             //
-            object_map[k] = pb_trigger_info->object().size();
+            _trigger_object_map[k] = pb_trigger_info->object().size();
 
             addTriggerObject(pb_trigger_info->add_object(), objects[k]);
         }
 
-        // Store producer key in map
+        // Add trigger object producer to the event; name is lowered in
+        // the scratch string to keep its storage between events
         //
-        producer_map[producer_id] = pb_trigger_info->producer().size();
-
-        // Add trigger object producer to the event
-        //
-        string producer_name(*producer);
+        string &producer_name = _producer_name;
+        producer_name.assign(producer->begin(), producer->end());
         to_lower(producer_name);
 
         bsm::TriggerProducer *producer = pb_trigger_info->add_producer();
@@ -422,19 +1108,27 @@ bool InputMaker::triggers(const edm::Event &event,
 
     // Save filters
     //
+    if (_trigger_filter_encoder)
+        _trigger_filter_encoder->clear();
+
+    _trigger_filter_map.assign(_hlt_filters.size(), NOT_SAVED);
+
     for(size_t filter = 0, filters = trigger_event->sizeFilters();
             filters > filter;
             ++filter)
     {
-        // Test if filter name matches user pattern
+        // Filter pattern, name and hash are evaluated once per menu
         //
-        string filter_name = trigger_event->filterTag(filter).label();
-        if (!regex_search(filter_name, _hlt_filter_pattern))
+        const uint32_t menu_filter =
+            hltFilter(trigger_event->filterTag(filter).label());
+
+        const HLTFilter &hlt_filter = _hlt_filters[menu_filter];
+        if (!hlt_filter.is_saved)
             continue;
 
         // Vector of associated ProtoBuf object keys that triggered filter
         //
-        vector<uint32_t> pb_keys;
+        _trigger_filter_keys.clear();
 
         // Process associated trigger objects
         //
@@ -446,44 +1140,66 @@ bool InputMaker::triggers(const edm::Event &event,
             // Save associated trigger object if it was not added by 
             // any producer yet
             //
-            uint32_t pb_key = pb_trigger_info->object().size();
-            if (object_map.end() == object_map.find(*key))
+            uint32_t &pb_key = _trigger_object_map[*key];
+            if (NOT_SAVED == pb_key)
             {
                 // Store key in map
                 //
-                object_map[*key] = pb_key;
+                pb_key = pb_trigger_info->object().size();
 
                 addTriggerObject(pb_trigger_info->add_object(),
                         objects[*key]);
             }
-            else
-                pb_key = object_map[*key];
 
-            pb_keys.push_back(pb_key);
+            _trigger_filter_keys.push_back(pb_key);
         }
 
-        // Store filter key in map
+        // Store filter key in map: filters unknown to the menu are added
+        // in the loop
         //
-        filter_map[filter_name] = pb_trigger_info->filter().size();
+        if (_trigger_filter_map.size() <= menu_filter)
+            _trigger_filter_map.resize(_hlt_filters.size(), NOT_SAVED);
 
-        // Add trigger object filter to the event
+        _trigger_filter_map[menu_filter] = pb_trigger_info->filter().size();
+
+        // Filters used in trigger matching
         //
-        to_lower(filter_name);
+        for(int object = 0; MATCH_OBJECTS > object; ++object)
+        {
+            if (hlt_filter.matching & (1u << object))
+                _trigger_matching[object].event_filters.push_back(
+                        pb_trigger_info->filter().size());
+        }
 
+        // Add trigger object filter to the event
+        //
         bsm::TriggerFilter *filter = pb_trigger_info->add_filter();
-        const size_t hash = make_hash(filter_name);
-        filter->set_hash(hash);
+        filter->set_hash(hlt_filter.hash);
 
-        for(vector<uint32_t>::const_iterator key = pb_keys.begin();
-                pb_keys.end() != key;
-                ++key)
+        if (_trigger_filter_encoder)
+        {
+            const string &keys =
+                _trigger_filter_encoder->encode(_trigger_filter_keys);
+
+            if (!keys.empty())
+                _event_recycler->addString(filter,
+                        extra_field::TRIGGER_FILTER_KEYS,
+                        keys);
+        }
+        else
         {
-            filter->add_key(*key);
+            for(vector<uint32_t>::const_iterator key =
+                        _trigger_filter_keys.begin();
+                    _trigger_filter_keys.end() != key;
+                    ++key)
+            {
+                filter->add_key(*key);
+            }
         }
 
         // Add trigger object filter to the input
         //
-        addHLTFilter(hash, filter_name);
+        addHLTFilter(hlt_filter.hash, hlt_filter.name);
     }
 
     // Process only triggers that are loaded in the menu 
@@ -498,20 +1214,18 @@ bool InputMaker::triggers(const edm::Event &event,
         trigger->set_pass(trigger_results->accept(hlt->first));
         trigger->set_version(hlt->second.version);
 
-        // Add associated trigger filters
+        if (trigger->pass())
+            _lumi_summary->acceptTrigger(hlt->second.hash);
+
+        // Add associated trigger filters that are saved in the event
         //
-        const Names &modules = _hlt_config->moduleLabels(hlt->second.full_name);
-        for(Names::const_iterator module = modules.begin();
-                modules.end() != module;
-                ++module)
+        const vector<uint32_t> &path_filters = hlt->second.filters;
+        for(vector<uint32_t>::const_iterator filter = path_filters.begin();
+                path_filters.end() != filter;
+                ++filter)
         {
-            // Search for module in the extracted filters list
-            //
-            MapNameToId::const_iterator filter = filter_map.find(*module);
-            if (filter_map.end() == filter)
-                continue;
-
-            trigger->add_filter(filter->second);
+            if (NOT_SAVED != _trigger_filter_map[*filter])
+                trigger->add_filter(_trigger_filter_map[*filter]);
         }
 
         // Add new path to the ProtoBuf input map
@@ -540,43 +1254,60 @@ bool InputMaker::isTriggerItemInCollection(const TriggerItems &collection,
     return false;
 }
 
+// Every stream keeps own trigger menu in the input
+//
 void InputMaker::addHLTPath(const std::size_t &hash, const std::string &name)
 {
-    bsm::Input::Info::Trigger *triggers =
-        _writer->input()->mutable_info()->mutable_trigger();
+    for(Writers::const_iterator writer = _writers.begin();
+            _writers.end() != writer;
+            ++writer)
+    {
+        bsm::Input::Info::Trigger *triggers =
+            (*writer)->input()->mutable_info()->mutable_trigger();
 
-    if (isTriggerItemInCollection(triggers->path(), hash))
-        return;
+        if (isTriggerItemInCollection(triggers->path(), hash))
+            continue;
 
-    bsm::TriggerItem *item = triggers->add_path();
-    item->set_hash(hash);
-    item->set_name(name);
+        bsm::TriggerItem *item = triggers->add_path();
+        item->set_hash(hash);
+        item->set_name(name);
+    }
 }
 
 void InputMaker::addHLTProducer(const std::size_t &hash, const std::string &name)
 {
-    bsm::Input::Info::Trigger *triggers =
-        _writer->input()->mutable_info()->mutable_trigger();
+    for(Writers::const_iterator writer = _writers.begin();
+            _writers.end() != writer;
+            ++writer)
+    {
+        bsm::Input::Info::Trigger *triggers =
+            (*writer)->input()->mutable_info()->mutable_trigger();
 
-    if (isTriggerItemInCollection(triggers->producer(), hash))
-        return;
+        if (isTriggerItemInCollection(triggers->producer(), hash))
+            continue;
 
-    bsm::TriggerItem *item = triggers->add_producer();
-    item->set_hash(hash);
-    item->set_name(name);
+        bsm::TriggerItem *item = triggers->add_producer();
+        item->set_hash(hash);
+        item->set_name(name);
+    }
 }
 
 void InputMaker::addHLTFilter(const std::size_t &hash, const std::string &name)
 {
-    bsm::Input::Info::Trigger *triggers =
-        _writer->input()->mutable_info()->mutable_trigger();
+    for(Writers::const_iterator writer = _writers.begin();
+            _writers.end() != writer;
+            ++writer)
+    {
+        bsm::Input::Info::Trigger *triggers =
+            (*writer)->input()->mutable_info()->mutable_trigger();
 
-    if (isTriggerItemInCollection(triggers->filter(), hash))
-        return;
+        if (isTriggerItemInCollection(triggers->filter(), hash))
+            continue;
 
-    bsm::TriggerItem *item = triggers->add_filter();
-    item->set_hash(hash);
-    item->set_name(name);
+        bsm::TriggerItem *item = triggers->add_filter();
+        item->set_hash(hash);
+        item->set_name(name);
+    }
 }
 
 void InputMaker::addBTags(Jet *pb, const pat::Jet *pat)
@@ -602,16 +1333,15 @@ void InputMaker::addBTags(Jet *pb, const pat::Jet *pat)
             pat->bDiscriminator("simpleSecondaryVertexHighPurBJetTags"));
 }
 
-void InputMaker::pileUp(const edm::Event &event)
+void InputMaker::pileUp(const EventContext &context)
 {
     if (_pileup_tag.label().empty())
         return;
 
     typedef vector<PileupSummaryInfo> Pileup;
-    Handle<Pileup> pileup;
-    event.getByLabel(_pileup_tag, pileup);
+    const Pileup *pileup = context.product<Pileup>(_pileup_tag);
 
-    if (!pileup.isValid())
+    if (!pileup)
     {
         LogWarning("InputMaker")
             << "failed to extract pileup";
@@ -651,18 +1381,210 @@ void InputMaker::pileUp(const edm::Event &event)
     }
 }
 
-void InputMaker::genParticle(const edm::Event &event)
+void InputMaker::countPileUp(const EventContext &context)
+{
+    const PileupSummaryInfo *pileup = inTimePileUp(context);
+
+    if (pileup)
+        _lumi_summary->addPileup(pileup->getPU_NumInteractions());
+}
+
+const PileupSummaryInfo *InputMaker::inTimePileUp(const EventContext &context)
+{
+    if (_pileup_tag.label().empty())
+        return 0;
+
+    // Pileup is not available in data: missing product is not reported
+    //
+    typedef vector<PileupSummaryInfo> Pileup;
+    const Pileup *pileup = context.product<Pileup>(_pileup_tag);
+
+    if (!pileup)
+        return 0;
+
+    for(Pileup::const_iterator pu = pileup->begin();
+            pileup->end() != pu;
+            ++pu)
+    {
+        if (!pu->getBunchCrossing())
+            return &*pu;
+    }
+
+    return 0;
+}
+
+void InputMaker::fillHistograms(const Histograms::Stage &stage,
+        const EventContext &context)
 {
+    Histograms &histograms = *_histograms;
+    if (!histograms.isUsed(stage))
+        return;
+
+    // Input collections are looped only if their variables are used
+    //
+    const bool is_jet_used = histograms.isUsed(stage, Histograms::JET_PT)
+        || histograms.isUsed(stage, Histograms::JET_ETA);
+
+    const bool is_electron_used =
+        histograms.isUsed(stage, Histograms::ELECTRON_PT)
+        || histograms.isUsed(stage, Histograms::ELECTRON_ETA)
+        || histograms.isUsed(stage, Histograms::ELECTRON_ISOLATION);
+
+    const bool is_muon_used = histograms.isUsed(stage, Histograms::MUON_PT)
+        || histograms.isUsed(stage, Histograms::MUON_ETA)
+        || histograms.isUsed(stage, Histograms::MUON_ISOLATION);
+
+    // Input collections before selection or selected objects
+    //
+    if (Histograms::PRE == stage)
+    {
+        const pat::JetCollection *jets = is_jet_used
+            ? context.product<pat::JetCollection>(_jet_selector->tag())
+            : 0;
+        if (jets)
+        {
+            for(pat::JetCollection::const_iterator jet = jets->begin();
+                    jets->end() != jet;
+                    ++jet)
+            {
+                histograms.fill(stage, Histograms::JET_PT, jet->pt());
+                histograms.fill(stage, Histograms::JET_ETA, jet->eta());
+            }
+        }
+
+        const pat::ElectronCollection *electrons = is_electron_used
+            ? context.product<pat::ElectronCollection>(
+                    _electron_selector->tag())
+            : 0;
+        if (electrons)
+        {
+            for(pat::ElectronCollection::const_iterator electron =
+                        electrons->begin();
+                    electrons->end() != electron;
+                    ++electron)
+            {
+                histograms.fill(stage, Histograms::ELECTRON_PT,
+                        electron->pt());
+                histograms.fill(stage, Histograms::ELECTRON_ETA,
+                        electron->eta());
+
+                if (histograms.isUsed(stage, Histograms::ELECTRON_ISOLATION))
+                    histograms.fill(stage, Histograms::ELECTRON_ISOLATION,
+                            isolation(*electron));
+            }
+        }
+
+        const pat::MuonCollection *muons = is_muon_used
+            ? context.product<pat::MuonCollection>(_muon_selector->tag())
+            : 0;
+        if (muons)
+        {
+            for(pat::MuonCollection::const_iterator muon = muons->begin();
+                    muons->end() != muon;
+                    ++muon)
+            {
+                histograms.fill(stage, Histograms::MUON_PT, muon->pt());
+                histograms.fill(stage, Histograms::MUON_ETA, muon->eta());
+
+                if (histograms.isUsed(stage, Histograms::MUON_ISOLATION))
+                    histograms.fill(stage, Histograms::MUON_ISOLATION,
+                            isolation(*muon));
+            }
+        }
+    }
+    else
+    {
+        typedef JetSelector::Jets Jets;
+
+        const Jets &jets = _jet_selector->jet();
+        for(Jets::const_iterator jet = jets.begin();
+                is_jet_used && jets.end() != jet;
+                ++jet)
+        {
+            // Jets that pass only systematic variations are not selected
+            //
+            if (!(jet->variations & 1))
+                continue;
+
+            histograms.fill(stage, Histograms::JET_PT,
+                    jet->corrected_p4.pt());
+            histograms.fill(stage, Histograms::JET_ETA,
+                    jet->corrected_p4.eta());
+        }
+
+        typedef ElectronSelector::Electrons Electrons;
+
+        const Electrons &electrons = _electron_selector->electron();
+        for(Electrons::const_iterator electron = electrons.begin();
+                is_electron_used && electrons.end() != electron;
+                ++electron)
+        {
+            histograms.fill(stage, Histograms::ELECTRON_PT,
+                    electron->electron->pt());
+            histograms.fill(stage, Histograms::ELECTRON_ETA,
+                    electron->electron->eta());
+
+            if (histograms.isUsed(stage, Histograms::ELECTRON_ISOLATION))
+                histograms.fill(stage, Histograms::ELECTRON_ISOLATION,
+                        isolation(*electron->electron));
+        }
+
+        typedef MuonSelector::Muons Muons;
+
+        const Muons &muons = _muon_selector->muon();
+        for(Muons::const_iterator muon = muons.begin();
+                is_muon_used && muons.end() != muon;
+                ++muon)
+        {
+            histograms.fill(stage, Histograms::MUON_PT, muon->muon->pt());
+            histograms.fill(stage, Histograms::MUON_ETA, muon->muon->eta());
+
+            if (histograms.isUsed(stage, Histograms::MUON_ISOLATION))
+                histograms.fill(stage, Histograms::MUON_ISOLATION,
+                        isolation(*muon->muon));
+        }
+    }
+
+    // Event quantities
+    //
+    if (histograms.isUsed(stage, Histograms::NPV))
+        histograms.fill(stage, Histograms::NPV, context.npv());
+
+    if (histograms.isUsed(stage, Histograms::MET)
+            && !_missing_energy_tag.label().empty())
+    {
+        const pat::METCollection *mets =
+            context.product<pat::METCollection>(_missing_energy_tag);
+
+        if (mets
+                && !mets->empty())
+            histograms.fill(stage, Histograms::MET, mets->begin()->pt());
+    }
+
+    if (histograms.isUsed(stage, Histograms::PILEUP))
+    {
+        const PileupSummaryInfo *pileup = inTimePileUp(context);
+
+        if (pileup)
+            histograms.fill(stage, Histograms::PILEUP,
+                    pileup->getPU_NumInteractions());
+    }
+}
+
+void InputMaker::genParticle(const EventContext &context)
+{
+    _gen_particle_table.clear();
+
     if (_gen_particle_tag.label().empty())
         return;
 
-    if (event.isRealData())
+    if (context.event().isRealData())
         return;
 
-    Handle<GenParticleCollection> gen_particle;
-    event.getByLabel(_gen_particle_tag, gen_particle);
+    const GenParticleCollection *gen_particle =
+        context.product<GenParticleCollection>(_gen_particle_tag);
 
-    if (!gen_particle.isValid())
+    if (!gen_particle)
     {
         LogWarning("InputMaker")
             << "failed to extract gen. particles";
@@ -670,26 +1592,27 @@ void InputMaker::genParticle(const edm::Event &event)
         return;
     }
 
-    for(GenParticleCollection::const_iterator particle = gen_particle->begin();
-            gen_particle->end() != particle;
-            ++particle)
-    {
-        // Skip anything that is neither stable, nor Top
-        //
-        if (3 != particle->status()
-                || TOP != abs(particle->pdgId()))
-            continue;
+    typedef GenParticleFilter::Roots Roots;
 
+    const Roots &roots = _gen_particle_filter->roots(*gen_particle);
+    for(Roots::const_iterator root = roots.begin();
+            roots.end() != root;
+            ++root)
+    {
         products(_event->add_gen_particle(),
-                *particle,
-                _gen_particle_depth_level);
+                *root->particle,
+                root->rule,
+                _gen_particle_filter->depth(root->rule));
     }
 }
 
 void InputMaker::products(bsm::GenParticle *pb_particle,
         const reco::Candidate &particle,
+        const uint32_t &rule,
         const uint32_t &level)
 {
+    _gen_particle_table.push_back(&particle);
+
     // Save current particle in ProtoBuf
     //
     pb_particle->set_id(particle.pdgId());
@@ -704,111 +1627,477 @@ void InputMaker::products(bsm::GenParticle *pb_particle,
     if (!level)
         return;
 
-    // Save its stable children
+    // Save its children with the rule statuses
     //
     for(reco::Candidate::const_iterator product = particle.begin();
             particle.end() != product;
             ++product)
     {
-        if (3 != product->status())
+        if (!_gen_particle_filter->isChild(rule, product->status()))
             continue;
 
-        products(pb_particle->add_child(), *product, level - 1);
+        products(pb_particle->add_child(), *product, rule, level - 1);
     }
 }
 
-bool InputMaker::electron(const edm::Event &event)
+int InputMaker::genParticleIndex(const reco::Candidate &particle) const
 {
-    bool result = _electron_selector->init(&event)
-        && 1 == _electron_selector->electron().size();
+    // Jet partons may refer to the full gen-particle collection while the
+    // trees are stored from its pruned copy: copies have the same id,
+    // status and p4. Tables are short, linear search is used
+    //
+    typedef vector<const reco::Candidate *> Table;
 
-    if (result)
+    for(Table::const_iterator stored = _gen_particle_table.begin();
+            _gen_particle_table.end() != stored;
+            ++stored)
     {
-        typedef ElectronSelector::Electrons Electrons;
+        if (&particle == *stored)
+            return stored - _gen_particle_table.begin();
+    }
 
-        const Electrons &electrons = _electron_selector->electron();
-        for(Electrons::const_iterator electron = electrons.begin();
-                electrons.end() != electron;
-                ++electron)
-        {
-            bsm::Electron *pb_electron = _event->add_electron();
+    for(Table::const_iterator stored = _gen_particle_table.begin();
+            _gen_particle_table.end() != stored;
+            ++stored)
+    {
+        if (particle.pdgId() == (*stored)->pdgId()
+                && particle.status() == (*stored)->status()
+                && particle.p4() == (*stored)->p4())
+            return stored - _gen_particle_table.begin();
+    }
 
-            fill(pb_electron, *electron);
+    return -1;
+}
+
+uint32_t InputMaker::select(const EventContext &context,
+        uint32_t &jet_variations)
+{
+    jet_variations = 0;
+
+    if (!_electron_selector->init(context)
+            || !_muon_selector->init(context))
+        return 0;
+
+    const uint32_t electrons = _electron_selector->electron().size();
+    const uint32_t muons = _muon_selector->muon().size();
+
+    // Jets cleaning and corrections are skipped if no channel accepts
+    // leptons
+    //
+    uint32_t lepton_channels = 0;
+    for(size_t channel = 0; _channels.size() > channel; ++channel)
+    {
+        if (_channels[channel].acceptLeptons(electrons, muons))
+            lepton_channels |= 1u << channel;
+    }
+
+    if (!lepton_channels
+            || !_jet_selector->init(context,
+                _electron_selector->electron(),
+                _muon_selector->muon()))
+        return 0;
+
+    uint32_t channels = 0;
+    for(size_t channel = 0; _channels.size() > channel; ++channel)
+    {
+        if (!(lepton_channels & (1u << channel)))
+            continue;
+
+        const uint32_t variations =
+            _channels[channel].acceptJets(_jet_selector->selected());
+
+        if (variations)
+        {
+            channels |= 1u << channel;
+            jet_variations |= variations;
         }
     }
 
-    return result;
+    return channels;
 }
 
-bool InputMaker::muon(const edm::Event &event)
+void InputMaker::electron()
 {
-    bool result = _muon_selector->init(&event)
-        && _muon_selector->muon().empty();
+    typedef ElectronSelector::Electrons Electrons;
 
-    if (result)
+    const Electrons &electrons = _electron_selector->electron();
+    for(Electrons::const_iterator electron = electrons.begin();
+            electrons.end() != electron;
+            ++electron)
     {
-        typedef MuonSelector::Muons Muons;
+        bsm::Electron *pb_electron = _event->add_electron();
 
-        const Muons &muons = _muon_selector->muon();
-        for(Muons::const_iterator muon = muons.begin();
-                muons.end() != muon;
-                ++muon)
-        {
-            bsm::Muon *pb_muon = _event->add_muon();
+        fill(pb_electron, *electron);
+    }
+}
 
-            fill(pb_muon, *muon);
-        }
+void InputMaker::muon()
+{
+    typedef MuonSelector::Muons Muons;
+
+    const Muons &muons = _muon_selector->muon();
+    for(Muons::const_iterator muon = muons.begin();
+            muons.end() != muon;
+            ++muon)
+    {
+        bsm::Muon *pb_muon = _event->add_muon();
+
+        fill(pb_muon, *muon);
     }
+}
+
+void InputMaker::jet(const uint32_t &jet_variations)
+{
+    // Pass bits are stored only if systematics are evaluated
+    //
+    const bool has_systematics = 1 < _jet_selector->selected().size();
+    if (has_systematics)
+        utility::addVarint(_event.get(),
+                extra_field::EVENT_JET_VARIATIONS,
+                jet_variations);
+
+    typedef JetSelector::Jets Jets;
+
+    const Jets &jets = _jet_selector->jet();
+    for(Jets::const_iterator jet = jets.begin();
+            jets.end() != jet;
+            ++jet)
+    {
+        bsm::Jet *pb_jet = _event->add_jet();
 
-    return result;
+        fill(pb_jet, *jet);
+
+        if (has_systematics)
+            utility::addVarint(pb_jet,
+                    extra_field::JET_VARIATIONS,
+                    jet->variations);
+    }
 }
 
-bool InputMaker::jet(const edm::Event &event)
+void InputMaker::ttbarHypotheses(const EventContext &context)
 {
-    bool result = _jet_selector->init(&event,
-                _electron_selector->electron(),
-                _muon_selector->muon())
-        && 1 < _jet_selector->jet().size();
+    if (!_ttbar_hypotheses
+            || _missing_energy_tag.label().empty())
+        return;
+
+    // Leading selected lepton
+    //
+    typedef TtbarHypotheses::LorentzVector LorentzVector;
+
+    const LorentzVector *lepton = 0;
 
-    if (result)
+    typedef ElectronSelector::Electrons Electrons;
+
+    const Electrons &electrons = _electron_selector->electron();
+    for(Electrons::const_iterator electron = electrons.begin();
+            electrons.end() != electron;
+            ++electron)
     {
-        typedef JetSelector::Jets Jets;
+        const LorentzVector &p4 = electron->electron->p4();
+        if (!lepton
+                || lepton->pt() < p4.pt())
+            lepton = &p4;
+    }
 
-        const Jets &jets = _jet_selector->jet();
-        for(Jets::const_iterator jet = jets.begin();
-                jets.end() != jet;
-                ++jet)
-        {
-            bsm::Jet *pb_jet = _event->add_jet();
+    typedef MuonSelector::Muons Muons;
+
+    const Muons &muons = _muon_selector->muon();
+    for(Muons::const_iterator muon = muons.begin();
+            muons.end() != muon;
+            ++muon)
+    {
+        const LorentzVector &p4 = muon->muon->p4();
+        if (!lepton
+                || lepton->pt() < p4.pt())
+            lepton = &p4;
+    }
+
+    if (!lepton)
+        return;
+
+    const pat::METCollection *mets =
+        context.product<pat::METCollection>(_missing_energy_tag);
+
+    if (!mets
+            || mets->empty())
+        return;
+
+    // Nominal jets in the stored order: hypotheses refer to the jets by
+    // position in the event
+    //
+    _ttbar_jets.clear();
+    _ttbar_btags.clear();
+    _ttbar_jet_index.clear();
+
+    typedef JetSelector::Jets Jets;
+
+    const Jets &jets = _jet_selector->jet();
+    for(Jets::const_iterator jet = jets.begin();
+            jets.end() != jet
+                && numeric_limits<uint8_t>::max() >= jet - jets.begin();
+            ++jet)
+    {
+        if (!(jet->variations & 1))
+            continue;
+
+        _ttbar_jets.push_back(jet->corrected_p4);
+        _ttbar_btags.push_back(
+                jet->jet->bDiscriminator(_ttbar_hypotheses->btag()));
+        _ttbar_jet_index.push_back(jet - jets.begin());
+    }
+
+    _ttbar_hypotheses->reconstruct(*lepton,
+            mets->begin()->px(), mets->begin()->py(),
+            _ttbar_jets, _ttbar_btags,
+            _ttbar_result);
+
+    for(TtbarHypotheses::Hypotheses::iterator hypothesis =
+                _ttbar_result.begin();
+            _ttbar_result.end() != hypothesis;
+            ++hypothesis)
+    {
+        hypothesis->leptonic_b = _ttbar_jet_index[hypothesis->leptonic_b];
+        hypothesis->hadronic_b = _ttbar_jet_index[hypothesis->hadronic_b];
+        hypothesis->first_quark = _ttbar_jet_index[hypothesis->first_quark];
+        hypothesis->second_quark =
+            _ttbar_jet_index[hypothesis->second_quark];
+
+        utility::addVarint(_event.get(),
+                extra_field::EVENT_TTBAR_HYPOTHESES,
+                hypothesis->pack());
+        utility::addFloat(_event.get(),
+                extra_field::EVENT_TTBAR_CHI2,
+                hypothesis->chi2);
+    }
+}
+
+void InputMaker::write(const uint32_t &channels)
+{
+    // Event is serialized into each stream with all channel bits set, so
+    // streams share the same record
+    //
+    if (channels & _main_channels
+            && _writer->isOpen())
+        _writer->write(_event);
+
+    for(size_t channel = 0; _channel_writers.size() > channel; ++channel)
+    {
+        const boost::shared_ptr<Writer> &writer = _channel_writers[channel];
+
+        if (writer
+                && (channels & (1u << channel))
+                && writer->isOpen())
+            writer->write(_event);
+    }
+}
+
+void InputMaker::matchTriggers()
+{
+    for(int object = 0; MATCH_OBJECTS > object; ++object)
+    {
+        if (!_trigger_matching[object].event_filters.empty())
+            matchTrigger(static_cast<MatchObject>(object));
+    }
+}
 
-            fill(pb_jet, *jet);
+void InputMaker::matchTrigger(const MatchObject &type)
+{
+    typedef EtaPhiGrid::Indices Indices;
+    typedef vector<ObjectFilter> ObjectFilters;
+
+    TriggerMatching &matching = _trigger_matching[type];
+    const bsm::Event::TriggerInfo &trigger_info = _event->hlt();
+
+    // (object, filter) pairs sorted by object: filters of each trigger
+    // object are a contiguous range
+    //
+    ObjectFilters &object_filters = _match_object_filters;
+    object_filters.clear();
+    for(Indices::const_iterator filter = matching.event_filters.begin();
+            matching.event_filters.end() != filter;
+            ++filter)
+    {
+        // Keys are expanded whether these are stored plain or compact
+        //
+        TriggerFilterKeys::decode(trigger_info.filter(), *filter,
+                _trigger_filter_keys);
+
+        for(vector<uint32_t>::const_iterator key =
+                    _trigger_filter_keys.begin();
+                _trigger_filter_keys.end() != key;
+                ++key)
+        {
+            object_filters.push_back(make_pair(*key, *filter));
         }
     }
 
-    return result;
+    sort(object_filters.begin(), object_filters.end());
+
+    matching.grid->clear();
+    for(ObjectFilters::const_iterator object = object_filters.begin();
+            object_filters.end() != object;
+            ++object)
+    {
+        if (object_filters.begin() != object
+                && (object - 1)->first == object->first)
+            continue;
+
+        float eta;
+        float phi;
+        if (direction(trigger_info.object(object->first).p4(), eta, phi))
+            matching.grid->add(object->first, eta, phi);
+    }
+
+    matching.grid->build();
+
+    // Selected objects in the event
+    //
+    vector<google::protobuf::Message *> &pb_objects = _match_pb_objects;
+    vector<const bsm::LorentzVector *> &p4s = _match_p4s;
+    pb_objects.clear();
+    p4s.clear();
+
+    int objects_field = 0;
+    int filters_field = 0;
+    switch(type)
+    {
+        case MATCH_ELECTRON:
+            for(int index = 0; _event->electron_size() > index; ++index)
+            {
+                bsm::Electron *pb_electron = _event->mutable_electron(index);
+
+                pb_objects.push_back(pb_electron);
+                p4s.push_back(&pb_electron->physics_object().p4());
+            }
+
+            objects_field = extra_field::ELECTRON_TRIGGER_OBJECTS;
+            filters_field = extra_field::ELECTRON_TRIGGER_FILTERS;
+            break;
+
+        case MATCH_MUON:
+            for(int index = 0; _event->muon_size() > index; ++index)
+            {
+                bsm::Muon *pb_muon = _event->mutable_muon(index);
+
+                pb_objects.push_back(pb_muon);
+                p4s.push_back(&pb_muon->physics_object().p4());
+            }
+
+            objects_field = extra_field::MUON_TRIGGER_OBJECTS;
+            filters_field = extra_field::MUON_TRIGGER_FILTERS;
+            break;
+
+        case MATCH_JET:
+            for(int index = 0; _event->jet_size() > index; ++index)
+            {
+                bsm::Jet *pb_jet = _event->mutable_jet(index);
+
+                pb_objects.push_back(pb_jet);
+                p4s.push_back(&pb_jet->physics_object().p4());
+            }
+
+            objects_field = extra_field::JET_TRIGGER_OBJECTS;
+            filters_field = extra_field::JET_TRIGGER_FILTERS;
+            break;
+
+        default:
+            return;
+    }
+
+    Indices &matched_objects = _matched_objects;
+    Indices &matched_filters = _matched_filters;
+    for(size_t index = 0; pb_objects.size() > index; ++index)
+    {
+        float eta;
+        float phi;
+        if (!direction(*p4s[index], eta, phi))
+            continue;
+
+        matching.grid->find(eta, phi, matched_objects);
+
+        matched_filters.clear();
+        for(Indices::const_iterator object = matched_objects.begin();
+                matched_objects.end() != object;
+                ++object)
+        {
+            utility::addVarint(pb_objects[index], objects_field, *object);
+
+            for(ObjectFilters::const_iterator filter =
+                        lower_bound(object_filters.begin(),
+                            object_filters.end(),
+                            make_pair(*object, 0u));
+                    object_filters.end() != filter
+                        && *object == filter->first;
+                    ++filter)
+            {
+                matched_filters.push_back(filter->second);
+            }
+        }
+
+        sort(matched_filters.begin(), matched_filters.end());
+        matched_filters.erase(unique(matched_filters.begin(),
+                    matched_filters.end()),
+                matched_filters.end());
+
+        for(Indices::const_iterator filter = matched_filters.begin();
+                matched_filters.end() != filter;
+                ++filter)
+        {
+            utility::addVarint(pb_objects[index], filters_field, *filter);
+        }
+    }
 }
 
-void InputMaker::primaryVertex(const edm::Event &event)
+void InputMaker::primaryVertex(const EventContext &context)
 {
     if (_primary_vertex_tag.label().empty())
         return;
 
-    typedef vector<Vertex> PVCollection;
+    typedef EventContext::PrimaryVertices PVCollection;
 
-    Handle<PVCollection> primary_vertices;
-    event.getByLabel(_primary_vertex_tag, primary_vertices);
+    const PVCollection *primary_vertices = context.primaryVertices();
 
-    if (!primary_vertices.isValid())
+    if (!primary_vertices)
     {
         LogWarning("InputMaker") << "failed to extract primary_vertices";
 
         return;
     }
 
+    typedef EventContext::GoodPrimaryVertices GoodPVs;
+
+    const GoodPVs &good_vertices = context.goodPrimaryVertices();
+
+    // Counts are stored for all modes: vertices may be dropped
+    //
+    utility::addVarint(_event.get(), extra_field::EVENT_NPV,
+            primary_vertices->size());
+    utility::addVarint(_event.get(), extra_field::EVENT_GOOD_NPV,
+            good_vertices.size());
+
+    // Good vertices are in the collection order: both are walked at once
+    //
+    GoodPVs::const_iterator good_vertex = good_vertices.begin();
+    uint32_t stored = 0;
     for(PVCollection::const_iterator vertex = primary_vertices->begin();
             primary_vertices->end() != vertex;
             ++vertex)
     {
+        const bool is_good = good_vertices.end() != good_vertex
+            && &*vertex == *good_vertex;
+        if (is_good)
+            ++good_vertex;
+
+        if (PV_GOOD == _primary_vertex_storage
+                && !is_good)
+            continue;
+
+        if (PV_FIRST == _primary_vertex_storage
+                && _primary_vertex_limit <= stored)
+            break;
+
+        ++stored;
+
         bsm::PrimaryVertex *pb_vertex = _event->add_primary_vertex();
 
         utility::set(pb_vertex->mutable_vertex(), &vertex->position());
@@ -816,20 +2105,23 @@ void InputMaker::primaryVertex(const edm::Event &event)
         bsm::PrimaryVertex::Extra *extra = pb_vertex->mutable_extra();
         extra->set_ndof(vertex->ndof());
         extra->set_rho(vertex->position().Rho());
+
+        utility::addVarint(pb_vertex, extra_field::PRIMARY_VERTEX_GOOD,
+                is_good);
     }
 }
 
-void InputMaker::met(const edm::Event &event)
+void InputMaker::met(const EventContext &context)
 {
     if (_missing_energy_tag.label().empty())
         return;
 
     using pat::METCollection;
 
-    Handle<METCollection> mets;
-    event.getByLabel(_missing_energy_tag, mets);
+    const METCollection *mets =
+        context.product<METCollection>(_missing_energy_tag);
 
-    if (!mets.isValid())
+    if (!mets)
     {
         LogWarning("InputMaker") << "failed to extract mets";
 
@@ -863,8 +2155,11 @@ void InputMaker::addTriggerObject(bsm::TriggerObject *to,
     p4->set_pz(from.pz());
 }
 
-void InputMaker::fill(bsm::Electron *pb_electron, const pat::Electron *electron)
+void InputMaker::fill(bsm::Electron *pb_electron,
+        const ElectronSelector::Candidate &candidate)
 {
+    const pat::Electron *electron = candidate.electron;
+
     utility::set(pb_electron->mutable_physics_object()->mutable_p4(),
             &electron->p4());
     utility::set(pb_electron->mutable_physics_object()->mutable_vertex(),
@@ -883,71 +2178,25 @@ void InputMaker::fill(bsm::Electron *pb_electron, const pat::Electron *electron)
 
     bsm::Electron::Extra *extra = pb_electron->mutable_extra();
     extra->set_d0(electron->dB());
-    extra->set_super_cluster_eta(electron->superCluster()->eta());
-    extra->set_inner_track_expected_hits(electron->gsfTrack()->trackerExpectedHitsInner().numberOfHits());
+    extra->set_super_cluster_eta(candidate.super_cluster_eta);
+    extra->set_inner_track_expected_hits(candidate.inner_track_expected_hits);
 
     // Adding all the electron id info
-    // 
-    std::string postfix = "MC";
-    
-    // VeryLoose
-    set_electronid(
-       pb_electron,
-       bsm::Electron::VeryLoose,
-       electron->electronID(std::string("eidVeryLoose")+postfix)
-    );
-    // Loose 
-    set_electronid(
-       pb_electron,
-       bsm::Electron::Loose,
-       electron->electronID(std::string("eidLoose")+postfix)
-    );
-    // Loose 
-    set_electronid(
-       pb_electron,
-       bsm::Electron::Medium,
-       electron->electronID(std::string("eidMedium")+postfix)
-    );
-    // Tight 
-    set_electronid(
-       pb_electron,
-       bsm::Electron::Tight,
-       electron->electronID(std::string("eidTight")+postfix)
-    );
-    // SuperTight 
-    set_electronid(
-       pb_electron,
-       bsm::Electron::SuperTight,
-       electron->electronID(std::string("eidSuperTight")+postfix)
-    );
-    // HyperTight1 
-    set_electronid(
-       pb_electron,
-       bsm::Electron::HyperTight1,
-       electron->electronID(std::string("eidHyperTight1")+postfix)
-    );
-    // HyperTight2 
-    set_electronid(
-       pb_electron,
-       bsm::Electron::HyperTight2,
-       electron->electronID(std::string("eidHyperTight2")+postfix)
-    );
-    // HyperTight3
-    set_electronid(
-       pb_electron,
-       bsm::Electron::HyperTight3,
-       electron->electronID(std::string("eidHyperTight3")+postfix)
-    );
-    // HyperTight4
-    set_electronid(
-       pb_electron,
-       bsm::Electron::HyperTight4,
-       electron->electronID(std::string("eidHyperTight4")+postfix)
-    );
+    //
+    for(vector<ElectronID>::const_iterator id = _electron_ids.begin();
+            _electron_ids.end() != id;
+            ++id)
+    {
+        set_electronid(pb_electron, id->first,
+                electron->electronID(id->second));
+    }
 }
 
-void InputMaker::fill(bsm::Muon *pb_muon, const pat::Muon *muon)
+void InputMaker::fill(bsm::Muon *pb_muon,
+        const MuonSelector::Candidate &candidate)
 {
+    const pat::Muon *muon = candidate.muon;
+
     utility::set(pb_muon->mutable_physics_object()->mutable_p4(),
             &muon->p4());
     utility::set(pb_muon->mutable_physics_object()->mutable_vertex(),
@@ -967,28 +2216,32 @@ void InputMaker::fill(bsm::Muon *pb_muon, const pat::Muon *muon)
     bsm::Muon::Extra *extra = pb_muon->mutable_extra();
     extra->set_is_global(muon->isGlobalMuon());
     extra->set_is_tracker(muon->isTrackerMuon());
-    extra->set_d0(muon->dB());
+    extra->set_d0(candidate.d0);
     extra->set_number_of_matches(muon->numberOfMatches());
 
-    if (muon->isTrackerMuon())
+    // Use track quantities evaluated by selector
+    //
+    if (candidate.has_inner_track)
     {
         bsm::Track *track = pb_muon->mutable_inner_track();
-        track->set_hits(muon->innerTrack()->numberOfValidHits());
-        track->set_normalized_chi2(muon->innerTrack()->normalizedChi2());
+        track->set_hits(candidate.inner_track_hits);
+        track->set_normalized_chi2(candidate.inner_track_normalized_chi2);
 
-        extra->set_pixel_hits(muon->innerTrack()->hitPattern().pixelLayersWithMeasurement());
+        extra->set_pixel_hits(candidate.pixel_layers);
     }
 
-    if (muon->isGlobalMuon())
+    if (candidate.has_global_track)
     {
         bsm::Track *track = pb_muon->mutable_global_track();
-        track->set_hits(muon->globalTrack()->hitPattern().numberOfValidMuonHits());
-        track->set_normalized_chi2(muon->globalTrack()->normalizedChi2());
+        track->set_hits(candidate.global_track_muon_hits);
+        track->set_normalized_chi2(candidate.global_track_normalized_chi2);
     }
 }
 
-void InputMaker::fill(bsm::Jet *pb_jet, const pat::Jet *jet)
+void InputMaker::fill(bsm::Jet *pb_jet, const JetSelector::Candidate &candidate)
 {
+    const pat::Jet *jet = candidate.jet;
+
     // Save PAT corrected jet p4
     //
     utility::set(pb_jet->mutable_physics_object()->mutable_p4(),
@@ -999,11 +2252,11 @@ void InputMaker::fill(bsm::Jet *pb_jet, const pat::Jet *jet)
     // Extract uncorrected p4
     //
     utility::set(pb_jet->mutable_uncorrected_p4(),
-            &jet->correctedP4(0));
+            &candidate.uncorrected_p4);
 
-    addBTags(pb_jet, &*jet);
+    addBTags(pb_jet, jet);
 
-    pb_jet->mutable_extra()->set_area(jet->jetArea());
+    pb_jet->mutable_extra()->set_area(candidate.area);
 
     // Skip the rest if Generator Parton is not found for the jet
     //
@@ -1011,6 +2264,20 @@ void InputMaker::fill(bsm::Jet *pb_jet, const pat::Jet *jet)
         return;
 
     const reco::GenParticle *parton = jet->genParton();
+
+    // Parton is copied only if it is not in the stored gen-particles
+    //
+    if (_gen_parton_by_index)
+    {
+        const int index = genParticleIndex(*parton);
+        if (-1 != index)
+        {
+            utility::addVarint(pb_jet, extra_field::JET_GEN_PARTON, index);
+
+            return;
+        }
+    }
+
     bsm::GenParticle *pb_gen_particle = pb_jet->mutable_gen_parton();
 
     utility::set(pb_gen_particle->mutable_physics_object()->mutable_p4(),
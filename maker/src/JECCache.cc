@@ -0,0 +1,295 @@
+// Binary pre-compiled Jet Energy Correction parameters
+//
+// Created by Samvel Khalatyan, Feb 24, 2012
+// Copyright 2012, All rights reserved
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+#include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "FWCore/MessageLogger/interface/MessageLogger.h"
+
+#include "bsm_input_maker/maker/interface/JECCache.h"
+
+using namespace std;
+
+using edm::LogInfo;
+
+// Binary layout, all values in the host byte order:
+//
+//  Header
+//  definitions line [header.definitions chars, padded to 4 bytes]
+//  records: uint32 nvar, uint32 nparameters,
+//           float xmin[nvar], float xmax[nvar], float parameters[nparameters]
+//
+namespace
+{
+    const char MAGIC[8] = {'B', 'S', 'M', 'J', 'E', 'C', 0, 0};
+    const uint32_t ENDIANNESS = 0x01020304;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t checksum;
+        uint32_t definitions;
+        uint32_t records;
+    };
+
+    uint32_t padded(const uint32_t &size)
+    {
+        return (size + 3) & ~3u;
+    }
+
+    void write(ostream &out, const uint32_t &value)
+    {
+        out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void write(ostream &out, const vector<float> &values)
+    {
+        if (!values.empty())
+            out.write(reinterpret_cast<const char *>(&values[0]),
+                    values.size() * sizeof(float));
+    }
+
+    // Read-only memory mapped file
+    //
+    class MappedFile
+    {
+        public:
+            MappedFile(const string &filename):
+                _data(0),
+                _size(0)
+            {
+                const int fd = open(filename.c_str(), O_RDONLY);
+                if (0 > fd)
+                    return;
+
+                struct stat info;
+                if (!fstat(fd, &info) && 0 < info.st_size)
+                {
+                    void *data = mmap(0, info.st_size, PROT_READ, MAP_PRIVATE,
+                            fd, 0);
+
+                    if (MAP_FAILED != data)
+                    {
+                        _data = static_cast<const char *>(data);
+                        _size = info.st_size;
+                    }
+                }
+
+                close(fd);
+            }
+
+            ~MappedFile()
+            {
+                if (_data)
+                    munmap(const_cast<char *>(_data), _size);
+            }
+
+            const char *data() const
+            {
+                return _data;
+            }
+
+            size_t size() const
+            {
+                return _size;
+            }
+
+        private:
+            const char *_data;
+            size_t _size;
+    };
+}
+
+uint64_t bsm::jec::checksum(const string &filename)
+{
+    MappedFile file(filename);
+
+    uint64_t hash = 14695981039346656037ULL;
+    for(const char *c = file.data(), *end = file.data() + file.size();
+            end != c;
+            ++c)
+    {
+        hash ^= static_cast<unsigned char>(*c);
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+string bsm::jec::binaryFilename(const string &text_filename)
+{
+    return text_filename + ".bin";
+}
+
+bool bsm::jec::compile(const string &text_filename,
+        const string &binary_filename)
+{
+    typedef vector<string> Names;
+
+    const JetCorrectorParameters parameters(text_filename);
+    const JetCorrectorParameters::Definitions &definitions =
+        parameters.definitions();
+
+    // Definitions are stored as a line, that is accepted by Definitions
+    //
+    ostringstream line;
+    line << definitions.binVar().size();
+    for(Names::const_iterator name = definitions.binVar().begin();
+            definitions.binVar().end() != name;
+            ++name)
+    {
+        line << " " << *name;
+    }
+
+    line << " " << definitions.parVar().size();
+    for(Names::const_iterator name = definitions.parVar().begin();
+            definitions.parVar().end() != name;
+            ++name)
+    {
+        line << " " << *name;
+    }
+
+    line << " " << definitions.formula()
+        << " " << (definitions.isResponse() ? "Response" : "Correction")
+        << " " << definitions.level();
+
+    Header header;
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.byte_order = ENDIANNESS;
+    header.checksum = checksum(text_filename);
+    header.definitions = line.str().size();
+    header.records = parameters.size();
+
+    // Write into temporary file and move it in place: concurrent jobs never
+    // see partially written cache
+    //
+    const string tmp_filename = binary_filename + ".tmp";
+    {
+        ofstream out(tmp_filename.c_str(), ios::binary | ios::trunc);
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        vector<char> definitions_line(padded(header.definitions), 0);
+        memcpy(&definitions_line[0], line.str().data(), header.definitions);
+        out.write(&definitions_line[0], definitions_line.size());
+
+        for(uint32_t bin = 0; header.records > bin; ++bin)
+        {
+            const JetCorrectorParameters::Record &record =
+                parameters.record(bin);
+
+            vector<float> xmin;
+            vector<float> xmax;
+            for(uint32_t var = 0; record.nVar() > var; ++var)
+            {
+                xmin.push_back(record.xMin(var));
+                xmax.push_back(record.xMax(var));
+            }
+
+            write(out, record.nVar());
+            write(out, static_cast<uint32_t>(record.parameters().size()));
+            write(out, xmin);
+            write(out, xmax);
+            write(out, record.parameters());
+        }
+
+        if (!out)
+        {
+            unlink(tmp_filename.c_str());
+
+            return false;
+        }
+    }
+
+    return !rename(tmp_filename.c_str(), binary_filename.c_str());
+}
+
+bool bsm::jec::load(const string &binary_filename,
+        const uint64_t &checksum,
+        JetCorrectorParameters &parameters)
+{
+    MappedFile file(binary_filename);
+    if (!file.data()
+            || sizeof(Header) > file.size())
+        return false;
+
+    const Header *header = reinterpret_cast<const Header *>(file.data());
+    if (memcmp(header->magic, MAGIC, sizeof(MAGIC))
+            || VERSION != header->version
+            || ENDIANNESS != header->byte_order
+            || checksum != header->checksum)
+        return false;
+
+    const char *data = file.data() + sizeof(Header);
+    const char *end = file.data() + file.size();
+
+    if (end - data < static_cast<ptrdiff_t>(padded(header->definitions)))
+        return false;
+
+    const JetCorrectorParameters::Definitions definitions(
+            string(data, header->definitions));
+    data += padded(header->definitions);
+
+    vector<JetCorrectorParameters::Record> records;
+    records.reserve(min<size_t>(header->records, file.size()));
+    for(uint32_t bin = 0; header->records > bin; ++bin)
+    {
+        if (end - data < static_cast<ptrdiff_t>(2 * sizeof(uint32_t)))
+            return false;
+
+        const uint32_t *sizes = reinterpret_cast<const uint32_t *>(data);
+        const uint32_t nvar = sizes[0];
+        const uint32_t nparameters = sizes[1];
+        data += 2 * sizeof(uint32_t);
+
+        const size_t floats = 2 * nvar + nparameters;
+        if (end - data < static_cast<ptrdiff_t>(floats * sizeof(float)))
+            return false;
+
+        const float *values = reinterpret_cast<const float *>(data);
+        data += floats * sizeof(float);
+
+        records.push_back(JetCorrectorParameters::Record(nvar,
+                    vector<float>(values, values + nvar),
+                    vector<float>(values + nvar, values + 2 * nvar),
+                    vector<float>(values + 2 * nvar, values + floats)));
+    }
+
+    parameters = JetCorrectorParameters(definitions, records);
+
+    return true;
+}
+
+JetCorrectorParameters bsm::jec::load(const string &text_filename)
+{
+    JetCorrectorParameters parameters;
+
+    const string binary_filename = binaryFilename(text_filename);
+    if (load(binary_filename, checksum(text_filename), parameters))
+    {
+        LogInfo("JECCache") << "Load JEC binary: " << binary_filename;
+
+        return parameters;
+    }
+
+    LogInfo("JECCache")
+        << "binary JEC is not available or out of date: parse "
+        << text_filename;
+
+    return JetCorrectorParameters(text_filename);
+}
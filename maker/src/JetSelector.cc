@@ -3,17 +3,22 @@
 // Created by Samvel Khalatyan, Oct 10, 2011
 // Copyright 2011, All rights reserved
 
-#include "DataFormats/Common/interface/Handle.h"
-#include "DataFormats/Math/interface/deltaR.h"
+#include <algorithm>
+#include <cmath>
+
 #include "DataFormats/PatCandidates/interface/Electron.h"
 #include "DataFormats/PatCandidates/interface/Jet.h"
 #include "DataFormats/PatCandidates/interface/Muon.h"
 #include "DataFormats/VertexReco/interface/Vertex.h"
-#include "FWCore/Framework/interface/Event.h"
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
-#include "CondFormats/JetMETObjects/interface/FactorizedJetCorrector.h"
+#include "CondFormats/JetMETObjects/interface/JetCorrectionUncertainty.h"
 #include "CondFormats/JetMETObjects/interface/JetCorrectorParameters.h"
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
 
+#include "bsm_input_maker/maker/interface/BatchJetCorrector.h"
+#include "bsm_input_maker/maker/interface/EventContext.h"
+#include "bsm_input_maker/maker/interface/JECCache.h"
 #include "bsm_input_maker/maker/interface/JetSelector.h"
 
 using namespace bsm;
@@ -21,14 +26,30 @@ using namespace edm;
 using namespace pat;
 using namespace std;
 
+// Cuts are applied to lepton-cleaned and corrected jets
+//
+namespace
+{
+    typedef JetSelector::Candidate Candidate;
+
+    // Cleaning with grid is faster than the kernel from about 16 leptons
+    // and 64 jets, see bin/bench_eta_phi_grid.cc
+    //
+    const size_t GRID_MIN_LEPTONS = 16;
+    const size_t GRID_MIN_PAIRS = 1024;
+}
+
 JetSelector::JetSelector(const InputTag &jet_tag,
-        const InputTag &primary_vertex_tag,
-        const InputTag &rho_tag,
-        const JECFiles &jec_files):
+        const ParameterSet &cuts,
+        const JECFiles &jec_files,
+        const double &lepton_cone):
     Selector(jet_tag),
-    _primary_vertex_tag(primary_vertex_tag),
-    _rho_tag(rho_tag)
+    _lepton_cone2(lepton_cone * lepton_cone),
+    _kinematics(cuts)
 {
+    if (0 < lepton_cone)
+        _jet_grid.reset(new EtaPhiGrid(lepton_cone, true));
+
     vector<JetCorrectorParameters> corrections;
     for(JECFiles::const_iterator file = jec_files.begin();
             jec_files.end() != file;
@@ -37,105 +58,191 @@ JetSelector::JetSelector(const InputTag &jet_tag,
         LogWarning("JetSelector")
             << "Load JEC: " << *file;
 
-        corrections.push_back(JetCorrectorParameters(*file));
+        corrections.push_back(jec::load(*file));
     }
 
-    _jec.reset(new FactorizedJetCorrector(corrections));
+    _jec.reset(new BatchJetCorrector(corrections));
+
+    // Pt and eta cuts are applied by kinematics kernel
+    //
+    _cuts.reset(new Cuts("jet", cuts));
+    _cuts->addExternal("pt");
+    _cuts->addExternal("eta");
+    _cuts->validate();
+
+    _variation_names.push_back("nominal");
 }
 
-bool JetSelector::init(const Event *event,
+bool JetSelector::init(const EventContext &context,
         const Electrons &electrons,
         const Muons &muons)
 {
     _jet.clear();
-
-    typedef vector<reco::Vertex> PrimaryVertices;
-    typedef math::XYZTLorentzVector LorentzVector;
+    _selected.assign(_variation_names.size(), 0);
 
     // Extract Primary Vertices, jets, rho
     //
-    Handle<PrimaryVertices> primary_vertices;
-    event->getByLabel(primaryVertexTag(), primary_vertices);
-
-    Handle<JetCollection> jets;
-    event->getByLabel(tag(), jets);
-
-    Handle<double> rho;
-    event->getByLabel(rhoTag(), rho);
+    const JetCollection *jets = context.product<JetCollection>(tag());
+    const double *rho = context.rho();
 
     bool result = false;
-    if (!primary_vertices.isValid())
+    if (!context.primaryVertices())
     {
         LogWarning("JetSelector")
             << "failed to extract primary vertices. Check Input Tag: "
-            << primaryVertexTag();
+            << context.primaryVertexTag();
     }
-    else if (!jets.isValid())
+    else if (!jets)
     {
         LogWarning("JetSelector")
             << "failed to extract jets. Check Input Tag: "
             << tag();
     }
-    else if (!rho.isValid())
+    else if (!rho)
     {
         LogWarning("JetSelector")
             << "failed to extract rho. Check Input Tag: "
-            << rhoTag();
+            << context.rhoTag();
     }
     else
     {
-        // Clean up jets: remove leptons
+        // Pack jets directions and raw p4s
         //
+        _jet_eta.clear();
+        _jet_phi.clear();
+        _jet_raw_p4.clear();
+        _jet_area.clear();
         for(JetCollection::const_iterator jet = jets->begin();
                 jets->end() != jet;
                 ++jet)
         {
-            const LorentzVector *pat_p4 = &jet->p4();
-            LorentzVector raw_p4 = jet->correctedP4(0);
+            _jet_eta.push_back(jet->eta());
+            _jet_phi.push_back(jet->phi());
+            _jet_raw_p4.push_back(jet->correctedP4(0));
+            _jet_area.push_back(jet->jetArea());
+        }
+
+        // Pack leptons
+        //
+        _lepton_eta.clear();
+        _lepton_phi.clear();
+        _lepton_p4.clear();
+        for(Electrons::const_iterator e = electrons.begin();
+                electrons.end() != e;
+                ++e)
+        {
+            _lepton_eta.push_back(e->electron->eta());
+            _lepton_phi.push_back(e->electron->phi());
+            _lepton_p4.push_back(&e->electron->p4());
+        }
+
+        for(Muons::const_iterator m = muons.begin();
+                muons.end() != m;
+                ++m)
+        {
+            _lepton_eta.push_back(m->muon->eta());
+            _lepton_phi.push_back(m->muon->phi());
+            _lepton_p4.push_back(&m->muon->p4());
+        }
+
+        // Clean up jets: remove leptons
+        //
+        _jet_clean_p4 = _jet_raw_p4;
+        clean();
+
+        // Correct all cleaned jets at once
+        //
+        _clean_eta.clear();
+        _clean_pt.clear();
+        _clean_e.clear();
+        for(LorentzVectors::const_iterator clean_p4 = _jet_clean_p4.begin();
+                _jet_clean_p4.end() != clean_p4;
+                ++clean_p4)
+        {
+            _clean_eta.push_back(clean_p4->eta());
+            _clean_pt.push_back(clean_p4->pt());
+            _clean_e.push_back(clean_p4->e());
+        }
+
+        _jec->correct(_clean_eta, _clean_pt, _clean_e, _jet_area,
+                *rho, context.npv(),
+                _jec_factor);
+
+        // Nominal pt and eta cuts are applied by kinematics kernel to the
+        // corrected and smeared jets. Neither changes eta
+        //
+        _kinematics.clear();
+        _jer_factor.resize(_jet_clean_p4.size());
+        for(size_t index = 0, size = _jet_clean_p4.size();
+                size > index;
+                ++index)
+        {
+            const float pt = _clean_pt[index] * _jec_factor[index];
+
+            _jer_factor[index] = _jer_central.empty()
+                ? 1
+                : smear((*jets)[index], _clean_eta[index], pt, _jer_central);
+
+            const float factor = _jec_factor[index] * _jer_factor[index];
+
+            _kinematics.add(pt * _jer_factor[index],
+                    _clean_eta[index],
+                    _jet_clean_p4[index].phi(),
+                    _clean_e[index] * factor);
+        }
+
+        // Varied jets may pass cuts even if nominal jet fails: all jets are
+        // visited if variations are evaluated
+        //
+        const Kinematics::Indices &selected = _kinematics.select();
+        const size_t visits = _variations.empty()
+            ? selected.size()
+            : jets->size();
+
+        for(size_t visit = 0; visits > visit; ++visit)
+        {
+            const size_t index = _variations.empty() ? selected[visit] : visit;
 
-            // Remove leptons from the jet
+            Candidate candidate;
+            candidate.jet = &(*jets)[index];
+            candidate.uncorrected_p4 = _jet_raw_p4[index];
+            candidate.corrected_p4 = _jet_clean_p4[index]
+                * (_jec_factor[index] * _jer_factor[index]);
+            candidate.correction = _jec_factor[index];
+            candidate.area = _jet_area[index];
+            candidate.jer = _jer_factor[index];
+            candidate.variations = _kinematics.isSelected(index)
+                && (*_cuts)(candidate) ? 1 : 0;
+
+            // Apply the same cuts to varied jets: nominal jet is already
+            // counted in the cuts statistics
             //
-            for(Electrons::const_iterator e = electrons.begin();
-                    electrons.end() != e;
-                    ++e)
+            for(size_t variation = 0, variations = _variations.size();
+                    variations > variation;
+                    ++variation)
             {
-                if (0.5 >= reco::deltaR((*e)->eta(),
-                            (*e)->phi(),
-                            pat_p4->eta(),
-                            pat_p4->phi()))
-                {
-                    raw_p4 -= (*e)->p4();
-                }
-            }
+                Candidate varied(candidate);
+                varied.corrected_p4 *= scale(_variations[variation],
+                        candidate);
 
-            for(Muons::const_iterator m = muons.begin();
-                    muons.end() != m;
-                    ++m)
-            {
-                if (0.5 >= reco::deltaR((*m)->eta(),
-                            (*m)->phi(),
-                            pat_p4->eta(),
-                            pat_p4->phi()))
-                {
-                    raw_p4 -= (*m)->p4();
-                }
+                if (_kinematics.isPassed(varied.corrected_p4.pt(),
+                            varied.corrected_p4.eta())
+                        && _cuts->evaluate(varied))
+                    candidate.variations |= 1u << (variation + 1);
             }
 
-            _jec->setJetEta(raw_p4.eta());
-            _jec->setJetPt(raw_p4.pt());
-            _jec->setJetE(raw_p4.e());
-            _jec->setNPV(primary_vertices->size());
-            _jec->setJetA(jet->jetArea());
-            _jec->setRho(*rho);
-
-            const double &correction = _jec->getCorrection();
-            raw_p4 *= correction;
+            if (!candidate.variations)
+                continue;
 
-            if (50 < raw_p4.pt()
-                    && 2.4 > fabs(raw_p4.eta()))
+            for(size_t variation = 0, variations = _selected.size();
+                    variations > variation;
+                    ++variation)
             {
-                _jet.push_back(&*jet);
+                if (candidate.variations & (1u << variation))
+                    ++_selected[variation];
             }
+
+            _jet.push_back(candidate);
         }
 
         result = true;
@@ -149,12 +256,224 @@ const JetSelector::Jets &JetSelector::jet() const
     return _jet;
 }
 
-const edm::InputTag &JetSelector::primaryVertexTag() const
+double JetSelector::leptonCone() const
+{
+    return sqrt(_lepton_cone2);
+}
+
+void JetSelector::useJECGrid(const uint32_t &points, const float &tolerance)
 {
-    return _primary_vertex_tag;
+    _jec->useGrid(points, tolerance);
 }
 
-const edm::InputTag &JetSelector::rhoTag() const
+void JetSelector::useSystematics(const ParameterSet &config)
 {
-    return _rho_tag;
+    typedef vector<string> Sources;
+
+    _variation_names.resize(1);
+    _variations.clear();
+
+    // JES: up and down variation per uncertainty source. Empty source
+    // stands for the file without sections
+    //
+    const string jes_file = config.getParameter<string>("jes_uncertainty");
+    if (!jes_file.empty())
+    {
+        const Sources sources = config.getParameter<Sources>("jes_sources");
+        for(Sources::const_iterator source = sources.begin();
+                sources.end() != source;
+                ++source)
+        {
+            LogWarning("JetSelector")
+                << "Load JES uncertainty: " << jes_file
+                << (source->empty() ? "" : " [" + *source + "]");
+
+            Variation variation;
+            variation.type = Variation::JES;
+            variation.uncertainty.reset(new JetCorrectionUncertainty(
+                        source->empty()
+                            ? JetCorrectorParameters(jes_file)
+                            : JetCorrectorParameters(jes_file, *source)));
+
+            const string name = "jes"
+                + (source->empty() ? "" : "_" + *source);
+
+            variation.is_up = true;
+            _variations.push_back(variation);
+            _variation_names.push_back(name + "_up");
+
+            variation.is_up = false;
+            _variations.push_back(variation);
+            _variation_names.push_back(name + "_down");
+        }
+    }
+
+    // JER: smear jets matched to generator jets with central, up and down
+    // scale factors in |eta| bins given by upper edges. Nominal jets are
+    // smeared with central factors
+    //
+    typedef vector<double> Doubles;
+
+    const Doubles jer_eta = config.getParameter<Doubles>("jer_eta");
+    const Doubles jer_central = config.getParameter<Doubles>("jer_central");
+    const Doubles jer_up = config.getParameter<Doubles>("jer_up");
+    const Doubles jer_down = config.getParameter<Doubles>("jer_down");
+
+    if (jer_eta.size() != jer_central.size()
+            || jer_eta.size() != jer_up.size()
+            || jer_eta.size() != jer_down.size())
+        throw cms::Exception("JetSelector")
+            << "jer_eta, jer_central, jer_up and jer_down should have the "
+            << "same size";
+
+    _jer_eta.assign(jer_eta.begin(), jer_eta.end());
+    _jer_central.assign(jer_central.begin(), jer_central.end());
+    _jer_up.assign(jer_up.begin(), jer_up.end());
+    _jer_down.assign(jer_down.begin(), jer_down.end());
+
+    if (!_jer_eta.empty())
+    {
+        Variation variation;
+        variation.type = Variation::JER;
+
+        variation.is_up = true;
+        _variations.push_back(variation);
+        _variation_names.push_back("jer_up");
+
+        variation.is_up = false;
+        _variations.push_back(variation);
+        _variation_names.push_back("jer_down");
+    }
+
+    // Jets keep pass flags in 32 bits mask
+    //
+    if (32 < _variation_names.size())
+        throw cms::Exception("JetSelector")
+            << "too many jet variations: " << _variation_names.size();
+}
+
+const JetSelector::Variations &JetSelector::variations() const
+{
+    return _variation_names;
+}
+
+const JetSelector::Counts &JetSelector::selected() const
+{
+    return _selected;
+}
+
+
+
+// Privates
+//
+float JetSelector::scale(const Variation &variation,
+        const Candidate &candidate) const
+{
+    const LorentzVector &p4 = candidate.corrected_p4;
+    if (0 >= p4.pt())
+        return 1;
+
+    if (Variation::JES == variation.type)
+    {
+        variation.uncertainty->setJetEta(p4.eta());
+        variation.uncertainty->setJetPt(p4.pt());
+
+        const float uncertainty =
+            variation.uncertainty->getUncertainty(variation.is_up);
+
+        return variation.is_up ? 1 + uncertainty : 1 - uncertainty;
+    }
+
+    // Up and down are relative to the central smearing of the nominal jet
+    //
+    const float pt = p4.pt() / candidate.jer;
+
+    return smear(*candidate.jet, p4.eta(), pt,
+            variation.is_up ? _jer_up : _jer_down) / candidate.jer;
+}
+
+float JetSelector::smear(const pat::Jet &jet,
+        const float &eta,
+        const float &pt,
+        const Floats &factors) const
+{
+    // JER is applied only to jets matched to generator jets
+    //
+    const reco::GenJet *gen_jet = jet.genJet();
+    if (!gen_jet
+            || 0 >= pt)
+        return 1;
+
+    const Floats::const_iterator bin =
+        lower_bound(_jer_eta.begin(), _jer_eta.end(), fabs(eta));
+    if (_jer_eta.end() == bin)
+        return 1;
+
+    const float factor = factors[bin - _jer_eta.begin()];
+    const float gen_pt = gen_jet->pt();
+
+    return max(0.0f, gen_pt + factor * (pt - gen_pt)) / pt;
+}
+
+void JetSelector::clean()
+{
+    const size_t jets = _jet_clean_p4.size();
+    if (!jets)
+        return;
+
+    // Grid pays off only if its build cost is shared by many queries
+    //
+    const size_t leptons = _lepton_p4.size();
+    if (_jet_grid
+            && GRID_MIN_LEPTONS <= leptons
+            && GRID_MIN_PAIRS <= leptons * jets)
+    {
+        cleanWithGrid();
+
+        return;
+    }
+
+    _dr2.resize(jets);
+
+    // Scan all jets per lepton: there are only a few leptons in the event
+    // while the kernel loop over jets is vectorized
+    //
+    for(size_t lepton = 0, leptons = _lepton_p4.size();
+            leptons > lepton;
+            ++lepton)
+    {
+        selector::deltaR2(_lepton_eta[lepton], _lepton_phi[lepton],
+                &_jet_eta[0], &_jet_phi[0],
+                jets,
+                &_dr2[0]);
+
+        for(size_t jet = 0; jets > jet; ++jet)
+        {
+            if (_lepton_cone2 >= _dr2[jet])
+                _jet_clean_p4[jet] -= *_lepton_p4[lepton];
+        }
+    }
+}
+
+void JetSelector::cleanWithGrid()
+{
+    _jet_grid->clear();
+    for(size_t jet = 0, jets = _jet_clean_p4.size(); jets > jet; ++jet)
+        _jet_grid->add(jet, _jet_eta[jet], _jet_phi[jet]);
+
+    _jet_grid->build();
+
+    for(size_t lepton = 0, leptons = _lepton_p4.size();
+            leptons > lepton;
+            ++lepton)
+    {
+        _jet_grid->find(_lepton_eta[lepton], _lepton_phi[lepton], _grid_jets);
+
+        for(EtaPhiGrid::Indices::const_iterator jet = _grid_jets.begin();
+                _grid_jets.end() != jet;
+                ++jet)
+        {
+            _jet_clean_p4[*jet] -= *_lepton_p4[lepton];
+        }
+    }
 }
@@ -0,0 +1,103 @@
+// Per-event structure of arrays with objects kinematics
+//
+// Created by Samvel Khalatyan, Mar 14, 2012
+// Copyright 2012, All rights reserved
+
+#include <cmath>
+#include <limits>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+
+#include "bsm_input_maker/maker/interface/Kinematics.h"
+#include "bsm_input_maker/maker/interface/Selector.h"
+
+using namespace std;
+
+using bsm::Kinematics;
+
+Kinematics::Kinematics(const edm::ParameterSet &cuts):
+    _min_pt(-numeric_limits<float>::max()),
+    _max_abs_eta(numeric_limits<float>::max())
+{
+    if (cuts.existsAs<double>("pt"))
+        _min_pt = cuts.getParameter<double>("pt");
+
+    if (cuts.existsAs<double>("eta"))
+        _max_abs_eta = cuts.getParameter<double>("eta");
+}
+
+void Kinematics::clear()
+{
+    _pt.clear();
+    _eta.clear();
+    _phi.clear();
+    _energy.clear();
+    _selected.clear();
+}
+
+void Kinematics::add(const float &pt, const float &eta,
+        const float &phi, const float &energy)
+{
+    _pt.push_back(pt);
+    _eta.push_back(eta);
+    _phi.push_back(phi);
+    _energy.push_back(energy);
+}
+
+size_t Kinematics::size() const
+{
+    return _pt.size();
+}
+
+const Kinematics::Floats &Kinematics::pt() const
+{
+    return _pt;
+}
+
+const Kinematics::Floats &Kinematics::eta() const
+{
+    return _eta;
+}
+
+const Kinematics::Floats &Kinematics::phi() const
+{
+    return _phi;
+}
+
+const Kinematics::Floats &Kinematics::energy() const
+{
+    return _energy;
+}
+
+const Kinematics::Indices &Kinematics::select()
+{
+    _selected.clear();
+
+    const size_t objects = size();
+    if (!objects)
+        return _selected;
+
+    _pass.resize(objects);
+    selector::kinematics(&_pt[0], &_eta[0], objects,
+            _min_pt, _max_abs_eta,
+            &_pass[0]);
+
+    for(size_t object = 0; objects > object; ++object)
+    {
+        if (_pass[object])
+            _selected.push_back(object);
+    }
+
+    return _selected;
+}
+
+bool Kinematics::isSelected(const size_t &index) const
+{
+    return _pass[index];
+}
+
+bool Kinematics::isPassed(const float &pt, const float &eta) const
+{
+    return _min_pt < pt
+        && _max_abs_eta > fabs(eta);
+}
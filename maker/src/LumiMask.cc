@@ -0,0 +1,135 @@
+// Certified luminosity sections mask
+//
+// Created by Samvel Khalatyan, Mar 6, 2012
+// Copyright 2012, All rights reserved
+
+#include <algorithm>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/LumiMask.h"
+
+using namespace std;
+using namespace boost;
+
+using bsm::LumiMask;
+
+namespace
+{
+    typedef pair<uint32_t, uint32_t> Interval;
+
+    bool isBefore(const uint32_t &lumi, const Interval &interval)
+    {
+        return lumi < interval.first;
+    }
+}
+
+LumiMask::LumiMask(const string &filename)
+{
+    using property_tree::ptree;
+
+    ptree json;
+    try
+    {
+        property_tree::read_json(filename, json);
+
+        for(ptree::const_iterator run = json.begin();
+                json.end() != run;
+                ++run)
+        {
+            Intervals &intervals =
+                _runs[lexical_cast<uint32_t>(run->first)];
+
+            for(ptree::const_iterator range = run->second.begin();
+                    run->second.end() != range;
+                    ++range)
+            {
+                vector<uint32_t> values;
+                for(ptree::const_iterator value = range->second.begin();
+                        range->second.end() != value;
+                        ++value)
+                {
+                    values.push_back(value->second.get_value<uint32_t>());
+                }
+
+                if (2 != values.size()
+                        || values[0] > values[1])
+                    throw cms::Exception("LumiMask")
+                        << "bad lumi range in run " << run->first
+                        << ": " << filename;
+
+                intervals.push_back(Interval(values[0], values[1]));
+            }
+        }
+    }
+    catch(const property_tree::ptree_error &error)
+    {
+        throw cms::Exception("LumiMask")
+            << "failed to read " << filename << ": " << error.what();
+    }
+    catch(const bad_lexical_cast &)
+    {
+        throw cms::Exception("LumiMask")
+            << "bad run number in " << filename;
+    }
+
+    // Sort and merge overlapping or adjacent intervals
+    //
+    for(Runs::iterator run = _runs.begin(); _runs.end() != run; ++run)
+    {
+        Intervals &intervals = run->second;
+        if (intervals.empty())
+            continue;
+
+        sort(intervals.begin(), intervals.end());
+
+        Intervals::iterator last = intervals.begin();
+        for(Intervals::iterator interval = intervals.begin() + 1;
+                intervals.end() != interval;
+                ++interval)
+        {
+            if (interval->first <= last->second
+                    || 1 == interval->first - last->second)
+                last->second = max(last->second, interval->second);
+            else
+                *++last = *interval;
+        }
+
+        intervals.erase(last + 1, intervals.end());
+    }
+}
+
+bool LumiMask::accept(const uint32_t &run, const uint32_t &lumi) const
+{
+    const Runs::const_iterator intervals = _runs.find(run);
+    if (_runs.end() == intervals)
+        return false;
+
+    // First interval that starts after the lumi: the lumi may only be in the
+    // previous one
+    //
+    const Intervals::const_iterator interval =
+        upper_bound(intervals->second.begin(), intervals->second.end(),
+                lumi, isBefore);
+
+    return intervals->second.begin() != interval
+        && lumi <= (interval - 1)->second;
+}
+
+uint32_t LumiMask::runs() const
+{
+    return _runs.size();
+}
+
+uint32_t LumiMask::intervals() const
+{
+    uint32_t result = 0;
+    for(Runs::const_iterator run = _runs.begin(); _runs.end() != run; ++run)
+        result += run->second.size();
+
+    return result;
+}
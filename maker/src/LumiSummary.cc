@@ -0,0 +1,173 @@
+// Per luminosity block event counts for the normalization
+//
+// Created by Samvel Khalatyan, Mar 8, 2012
+// Copyright 2012, All rights reserved
+
+#include <cstdio>
+#include <fstream>
+
+#include "bsm_input_maker/maker/interface/LumiSummary.h"
+
+using namespace std;
+
+using bsm::LumiSummary;
+
+namespace
+{
+    const char *STAGE_NAMES[] = {
+        "seen", "certified", "unique", "trigger", "selected"
+    };
+
+    template<typename T>
+        void writeList(ostream &out, const vector<T> &values,
+                const bool &is_quoted)
+    {
+        out << "[";
+        for(typename vector<T>::const_iterator value = values.begin();
+                values.end() != value;
+                ++value)
+        {
+            if (values.begin() != value)
+                out << ", ";
+
+            if (is_quoted)
+                out << "\"" << *value << "\"";
+            else
+                out << *value;
+        }
+        out << "]";
+    }
+}
+
+LumiSummary::LumiSummary(const Channels &channels):
+    _channels(channels),
+    _record(0)
+{
+}
+
+void LumiSummary::beginLumi(const uint32_t &run, const uint32_t &lumi)
+{
+    // Lumi may be split between input files: records are accumulated
+    //
+    const Records::iterator record = _records.find(Lumi(run, lumi));
+    if (_records.end() != record)
+    {
+        _record = &record->second;
+
+        return;
+    }
+
+    Record &new_record = _records[Lumi(run, lumi)];
+    new_record.stages.assign(STAGES, 0);
+    new_record.channels.assign(_channels.size(), 0);
+    new_record.pileup = 0;
+
+    _record = &new_record;
+}
+
+void LumiSummary::pass(const Stage &stage)
+{
+    if (_record)
+        ++_record->stages[stage];
+}
+
+void LumiSummary::passChannels(const uint32_t &mask)
+{
+    if (!_record)
+        return;
+
+    for(size_t channel = 0; _record->channels.size() > channel; ++channel)
+    {
+        if (mask & (1u << channel))
+            ++_record->channels[channel];
+    }
+}
+
+void LumiSummary::addPileup(const uint32_t &interactions)
+{
+    if (_record)
+        _record->pileup += interactions;
+}
+
+void LumiSummary::addTrigger(const size_t &hash, const string &name)
+{
+    if (_trigger_indices.count(hash))
+        return;
+
+    _trigger_indices[hash] = _triggers.size();
+    _triggers.push_back(name);
+}
+
+void LumiSummary::acceptTrigger(const size_t &hash)
+{
+    if (!_record)
+        return;
+
+    const TriggerIndices::const_iterator index = _trigger_indices.find(hash);
+    if (_trigger_indices.end() != index)
+        ++_record->triggers[index->second];
+}
+
+bool LumiSummary::write(const string &filename) const
+{
+    // Write into temporary file and move it in place: readers never see
+    // partially written summary
+    //
+    const string tmp_filename = filename + ".tmp";
+    {
+        ofstream out(tmp_filename.c_str(), ios::trunc);
+
+        out << "{\"stages\": "
+            << "[\"" << STAGE_NAMES[0] << "\"";
+        for(int stage = 1; STAGES > stage; ++stage)
+            out << ", \"" << STAGE_NAMES[stage] << "\"";
+        out << "]," << endl;
+
+        out << " \"channels\": ";
+        writeList(out, _channels, true);
+        out << "," << endl;
+
+        out << " \"triggers\": ";
+        writeList(out, _triggers, true);
+        out << "," << endl;
+
+        out << " \"lumis\": [";
+        for(Records::const_iterator record = _records.begin();
+                _records.end() != record;
+                ++record)
+        {
+            if (_records.begin() != record)
+                out << ",";
+
+            out << endl << "  [" << record->first.first
+                << ", " << record->first.second << ", ";
+            writeList(out, record->second.stages, false);
+            out << ", ";
+            writeList(out, record->second.channels, false);
+            out << ", " << record->second.pileup << ", [";
+
+            for(map<uint32_t, uint64_t>::const_iterator trigger =
+                        record->second.triggers.begin();
+                    record->second.triggers.end() != trigger;
+                    ++trigger)
+            {
+                if (record->second.triggers.begin() != trigger)
+                    out << ", ";
+
+                out << "[" << trigger->first << ", " << trigger->second << "]";
+            }
+
+            out << "]]";
+        }
+        out << endl << " ]" << endl << "}" << endl;
+
+        if (!out)
+        {
+            remove(tmp_filename.c_str());
+
+            return false;
+        }
+    }
+
+    return !rename(tmp_filename.c_str(), filename.c_str());
+}
@@ -3,12 +3,12 @@
 // Created by Samvel Khalatyan, Oct 10, 2011
 // Copyright 2011, All rights reserved
 
-#include "DataFormats/Common/interface/Handle.h"
 #include "DataFormats/PatCandidates/interface/Muon.h"
+#include "DataFormats/TrackReco/interface/Track.h"
 #include "DataFormats/VertexReco/interface/Vertex.h"
-#include "FWCore/Framework/interface/Event.h"
 #include "FWCore/MessageLogger/interface/MessageLogger.h"
 
+#include "bsm_input_maker/maker/interface/EventContext.h"
 #include "bsm_input_maker/maker/interface/MuonSelector.h"
 
 using namespace bsm;
@@ -16,33 +16,108 @@ using namespace edm;
 using namespace pat;
 using namespace std;
 
+// Cuts
+//
+namespace
+{
+    typedef MuonSelector::CutInput CutInput;
+
+    bool cutIsGlobal(CutInput &input, const double &)
+    {
+        return input.candidate.muon->isGlobalMuon();
+    }
+
+    bool cutIsTracker(CutInput &input, const double &)
+    {
+        return input.candidate.muon->isTrackerMuon();
+    }
+
+    bool cutMatches(CutInput &input, const double &threshold)
+    {
+        return threshold < input.candidate.muon->numberOfMatches();
+    }
+
+    bool cutGlobalTrackMuonHits(CutInput &input, const double &threshold)
+    {
+        return input.candidate.has_global_track
+            && threshold < input.candidate.global_track_muon_hits;
+    }
+
+    bool cutGlobalTrackChi2(CutInput &input, const double &threshold)
+    {
+        return input.candidate.has_global_track
+            && threshold > input.candidate.global_track_normalized_chi2;
+    }
+
+    bool cutInnerTrackHits(CutInput &input, const double &threshold)
+    {
+        return input.candidate.has_inner_track
+            && threshold < input.candidate.inner_track_hits;
+    }
+
+    bool cutPixelLayers(CutInput &input, const double &threshold)
+    {
+        return input.candidate.has_inner_track
+            && threshold < input.candidate.pixel_layers;
+    }
+
+    bool cutD0(CutInput &input, const double &threshold)
+    {
+        return threshold > fabs(input.candidate.d0);
+    }
+
+    bool cutDz(CutInput &input, const double &threshold)
+    {
+        return threshold > fabs(input.primary_vertex->position().z()
+                - input.candidate.muon->vertex().z());
+    }
+}
+
 MuonSelector::MuonSelector(const edm::InputTag &muon_tag,
-        const edm::InputTag &primary_vertex_tag):
+        const edm::ParameterSet &cuts):
     Selector(muon_tag),
-    _primary_vertex_tag(primary_vertex_tag)
+    _kinematics(cuts)
 {
+    // Cuts are added in the initial evaluation order. Pt and eta cuts are
+    // applied by kinematics kernel
+    //
+    _cuts.reset(new Cuts("muon", cuts));
+    _cuts->addExternal("pt");
+    _cuts->addExternal("eta");
+    _cuts->add("is_global", cutIsGlobal);
+    _cuts->add("is_tracker", cutIsTracker);
+    _cuts->add("matches", cutMatches);
+
+    // Tracks are loaded once by the first track cut: the load cost is
+    // measured separately and shared by the group
+    //
+    _cuts->addGroup("tracks", loadTracks);
+    _cuts->add("global_track_muon_hits", cutGlobalTrackMuonHits, "tracks");
+    _cuts->add("global_track_chi2", cutGlobalTrackChi2, "tracks");
+    _cuts->add("inner_track_hits", cutInnerTrackHits, "tracks");
+    _cuts->add("pixel_layers", cutPixelLayers, "tracks");
+    _cuts->add("d0", cutD0);
+    _cuts->add("dz", cutDz);
+    _cuts->validate();
 }
 
-bool MuonSelector::init(const edm::Event *event)
+bool MuonSelector::init(const EventContext &context)
 {
     _muon.clear();
 
-    typedef vector<reco::Vertex> PrimaryVertices;
+    typedef EventContext::PrimaryVertices PrimaryVertices;
 
-    Handle<PrimaryVertices> primary_vertices;
-    event->getByLabel(primaryVertexTag(), primary_vertices);
-
-    Handle<MuonCollection> muons;
-    event->getByLabel(tag(), muons);
+    const PrimaryVertices *primary_vertices = context.primaryVertices();
+    const MuonCollection *muons = context.product<MuonCollection>(tag());
 
     bool result = false;
-    if (!primary_vertices.isValid())
+    if (!primary_vertices)
     {
         LogWarning("MuonSelector")
             << "failed to extract primary vertices. Check Input Tag: "
-            << primaryVertexTag();
+            << context.primaryVertexTag();
     }
-    else if (!muons.isValid())
+    else if (!muons)
     {
         LogWarning("MuonSelector")
             << "failed to extract muons. Check Input Tag: "
@@ -54,27 +129,41 @@ bool MuonSelector::init(const edm::Event *event)
     }
     else
     {
-        const reco::Vertex *primary_vertex =
-            &*primary_vertices->begin();
+        CutInput input;
+        input.primary_vertex = &*primary_vertices->begin();
+
+        _kinematics.clear();
         for(MuonCollection::const_iterator muon = muons->begin();
                 muons->end() != muon;
                 ++muon)
         {
-            if (35 < muon->pt()
-                    && 2.1 > fabs(muon->eta())
-                    && muon->isGlobalMuon()
-                    && muon->isTrackerMuon()
-                    && 1 < muon->numberOfMatches()
-                    && 0 < muon->globalTrack()->hitPattern().numberOfValidMuonHits()
-                    && 10 > muon->globalTrack()->normalizedChi2()
-                    && 10 < muon->innerTrack()->numberOfValidHits()
-                    && 0 < muon->innerTrack()->hitPattern().pixelLayersWithMeasurement()
-                    && 0.02 > fabs(muon->dB())
-                    && 1 > fabs(primary_vertex->position().z()
-                        - muon->vertex().z()))
-            {
-                _muon.push_back(&*muon);
-            }
+            _kinematics.add(muon->pt(), muon->eta(),
+                    muon->phi(), muon->energy());
+        }
+
+        // Only muons that pass kinematic cuts are accessed again
+        //
+        typedef Kinematics::Indices Indices;
+
+        const Indices &selected = _kinematics.select();
+        for(Indices::const_iterator index = selected.begin();
+                selected.end() != index;
+                ++index)
+        {
+            const pat::Muon *muon = &(*muons)[*index];
+
+            input.candidate.muon = muon;
+            input.candidate.d0 = muon->dB();
+            input.is_tracks_loaded = false;
+
+            if (!(*_cuts)(input))
+                continue;
+
+            // Complete record if track cuts are disabled
+            //
+            loadTracks(input);
+
+            _muon.push_back(input.candidate);
         }
 
         result = true;
@@ -88,7 +177,49 @@ const MuonSelector::Muons &MuonSelector::muon() const
     return _muon;
 }
 
-const edm::InputTag &MuonSelector::primaryVertexTag() const
+void MuonSelector::loadTracks(CutInput &input)
 {
-    return _primary_vertex_tag;
+    if (input.is_tracks_loaded)
+        return;
+
+    input.is_tracks_loaded = true;
+
+    Candidate &candidate = input.candidate;
+    const pat::Muon *muon = candidate.muon;
+
+    candidate.has_inner_track = muon->isTrackerMuon()
+        && muon->innerTrack().isNonnull();
+
+    if (candidate.has_inner_track)
+    {
+        const reco::Track *track = muon->innerTrack().get();
+
+        candidate.inner_track_hits = track->numberOfValidHits();
+        candidate.inner_track_normalized_chi2 = track->normalizedChi2();
+        candidate.pixel_layers =
+            track->hitPattern().pixelLayersWithMeasurement();
+    }
+    else
+    {
+        candidate.inner_track_hits = 0;
+        candidate.inner_track_normalized_chi2 = 0;
+        candidate.pixel_layers = 0;
+    }
+
+    candidate.has_global_track = muon->isGlobalMuon()
+        && muon->globalTrack().isNonnull();
+
+    if (candidate.has_global_track)
+    {
+        const reco::Track *track = muon->globalTrack().get();
+
+        candidate.global_track_muon_hits =
+            track->hitPattern().numberOfValidMuonHits();
+        candidate.global_track_normalized_chi2 = track->normalizedChi2();
+    }
+    else
+    {
+        candidate.global_track_muon_hits = 0;
+        candidate.global_track_normalized_chi2 = 0;
+    }
 }
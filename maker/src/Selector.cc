@@ -3,6 +3,7 @@
 // Created by Samvel Khalatyan, Apr 25, 2011
 // Copyright 2011, All rights reserved
 
+#include <algorithm>
 #include <cmath>
 
 #include "DataFormats/VertexReco/interface/Vertex.h"
@@ -20,6 +21,46 @@ bool selector::isGoodPrimaryVertex(const reco::Vertex &vertex,
         && 2 >= fabs(vertex.position().Rho());
 }
 
+void selector::deltaR2(const float &eta, const float &phi,
+        const float *etas, const float *phis,
+        const std::size_t &size,
+        float *dr2)
+{
+    const float two_pi = 2 * M_PI;
+
+    // Local copies: output may alias the references and block vectorization
+    //
+    const float ref_eta = eta;
+    const float ref_phi = phi;
+
+    for(std::size_t i = 0, n = size; n > i; ++i)
+    {
+        const float deta = etas[i] - ref_eta;
+
+        // Both phi's are in [-pi, pi]: fold the difference into [0, pi]
+        //
+        float dphi = std::fabs(phis[i] - ref_phi);
+        dphi = std::min(dphi, two_pi - dphi);
+
+        dr2[i] = deta * deta + dphi * dphi;
+    }
+}
+
+void selector::kinematics(const float *pts, const float *etas,
+        const std::size_t &size,
+        const float &min_pt, const float &max_abs_eta,
+        uint32_t *pass)
+{
+    const float pt_threshold = min_pt;
+    const float eta_threshold = max_abs_eta;
+
+    for(std::size_t i = 0, n = size; n > i; ++i)
+    {
+        pass[i] = (pt_threshold < pts[i])
+            & (eta_threshold > std::fabs(etas[i]));
+    }
+}
+
 
 
 // Selector base
@@ -0,0 +1,281 @@
+// Compact trigger filter keys
+//
+// Created by Samvel Khalatyan, Mar 21, 2012
+// Copyright 2012, All rights reserved
+
+#include <google/protobuf/unknown_field_set.h>
+
+#include "bsm_input_maker/maker/interface/ExtraFields.h"
+#include "bsm_input_maker/maker/interface/TriggerFilterKeys.h"
+
+using namespace std;
+
+using google::protobuf::UnknownField;
+using google::protobuf::UnknownFieldSet;
+
+using bsm::TriggerFilterKeys;
+
+namespace
+{
+    // Number of the last filters compared to the new one
+    //
+    const uint32_t WINDOW = 8;
+
+    uint32_t varintSize(uint64_t value)
+    {
+        uint32_t size = 1;
+        for(; 0x80 <= value; value >>= 7)
+            ++size;
+
+        return size;
+    }
+
+    void addVarint(string &out, uint64_t value)
+    {
+        for(; 0x80 <= value; value >>= 7)
+            out.push_back(static_cast<char>(value | 0x80));
+
+        out.push_back(static_cast<char>(value));
+    }
+
+    // Return 0 if varint is truncated
+    //
+    const uint8_t *readVarint(const uint8_t *in, const uint8_t *end,
+            uint64_t &value)
+    {
+        value = 0;
+        for(int shift = 0; end > in && 64 > shift; shift += 7)
+        {
+            const uint8_t byte = *in++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+            if (!(byte & 0x80))
+                return in;
+        }
+
+        return 0;
+    }
+
+    uint64_t zigzag(const uint32_t &key, const uint32_t &previous)
+    {
+        const int64_t delta = static_cast<int64_t>(key) - previous;
+
+        return (static_cast<uint64_t>(delta) << 1)
+            ^ -static_cast<uint64_t>(0 > delta);
+    }
+
+    uint32_t unzigzag(const uint64_t &value, const uint32_t &previous)
+    {
+        return previous + static_cast<uint32_t>((value >> 1) ^ -(value & 1));
+    }
+
+    const string *encoded(const bsm::TriggerFilter &filter)
+    {
+        const UnknownFieldSet &fields = filter.unknown_fields();
+        for(int field = 0, size = fields.field_count(); size > field; ++field)
+        {
+            const UnknownField &unknown_field = fields.field(field);
+            if (bsm::extra_field::TRIGGER_FILTER_KEYS == unknown_field.number()
+                    && UnknownField::TYPE_LENGTH_DELIMITED
+                        == unknown_field.type())
+                return &unknown_field.length_delimited();
+        }
+
+        return 0;
+    }
+}
+
+TriggerFilterKeys::TriggerFilterKeys():
+    _recent(WINDOW),
+    _filters(0)
+{
+}
+
+void TriggerFilterKeys::clear()
+{
+    _filters = 0;
+}
+
+const string &TriggerFilterKeys::encode(const Keys &keys)
+{
+    const uint32_t index = _filters++;
+
+    uint32_t distance = 0;
+    if (!keys.empty())
+    {
+        for(uint32_t previous = 1, previous_filters = min(index, WINDOW);
+                previous_filters >= previous;
+                ++previous)
+        {
+            if (keys == _recent[(index - previous) % WINDOW])
+            {
+                distance = previous;
+
+                break;
+            }
+        }
+    }
+
+    _recent[index % WINDOW].assign(keys.begin(), keys.end());
+
+    // Filters without keys have nothing to store
+    //
+    _bytes.clear();
+    if (keys.empty())
+        return _bytes;
+
+    if (distance)
+    {
+        _bytes.push_back(REPEAT);
+        addVarint(_bytes, distance);
+    }
+    else
+        pack(keys);
+
+    return _bytes;
+}
+
+void TriggerFilterKeys::decode(const Filters &filters,
+        const int &filter,
+        Keys &keys)
+{
+    keys.clear();
+
+    // Follow repeats to the filter with keys; truncated or corrupted keys
+    // are dropped
+    //
+    for(int index = filter; 0 <= index && filters.size() > index; )
+    {
+        const TriggerFilter &pb_filter = filters.Get(index);
+
+        const string *bytes = encoded(pb_filter);
+        if (!bytes)
+        {
+            keys.assign(pb_filter.key().begin(), pb_filter.key().end());
+
+            return;
+        }
+
+        const uint8_t *in = reinterpret_cast<const uint8_t *>(bytes->data());
+        const uint8_t *end = in + bytes->size();
+        if (end == in)
+            return;
+
+        const int mode = *in++;
+
+        uint64_t value;
+        switch(mode)
+        {
+            case REPEAT:
+                if (!(in = readVarint(in, end, value))
+                        || !value
+                        || static_cast<uint64_t>(index) < value)
+                    return;
+
+                index -= value;
+                continue;
+
+            case DELTA:
+            {
+                // Every key takes at least one byte: corrupted count is
+                // not trusted for the allocation
+                //
+                if (!(in = readVarint(in, end, value))
+                        || static_cast<uint64_t>(end - in) < value)
+                    return;
+
+                keys.reserve(value);
+
+                uint32_t key = 0;
+                for(uint64_t count = value; count; --count)
+                {
+                    if (!(in = readVarint(in, end, value)))
+                    {
+                        keys.clear();
+
+                        return;
+                    }
+
+                    key = unzigzag(value, key);
+                    keys.push_back(key);
+                }
+
+                return;
+            }
+
+            case BITMAP:
+            {
+                if (!(in = readVarint(in, end, value)))
+                    return;
+
+                const uint32_t first = value;
+                for(uint32_t offset = 0; end > in; ++in, offset += 8)
+                {
+                    for(uint32_t bit = 0, byte = *in; byte; ++bit, byte >>= 1)
+                    {
+                        if (byte & 1)
+                            keys.push_back(first + offset + bit);
+                    }
+                }
+
+                return;
+            }
+
+            default:
+                return;
+        }
+    }
+}
+
+
+
+// Privates
+//
+void TriggerFilterKeys::pack(const Keys &keys)
+{
+    bool is_ascending = true;
+    uint32_t delta_size = varintSize(keys.size());
+
+    uint32_t previous = 0;
+    for(Keys::const_iterator key = keys.begin(); keys.end() != key; ++key)
+    {
+        if (keys.begin() != key
+                && previous >= *key)
+            is_ascending = false;
+
+        delta_size += varintSize(zigzag(*key, previous));
+        previous = *key;
+    }
+
+    const uint32_t first = keys.front();
+    const uint32_t bitmap_size = is_ascending
+        ? varintSize(first) + (keys.back() - first) / 8 + 1
+        : 0;
+
+    if (!is_ascending
+            || delta_size <= bitmap_size)
+    {
+        _bytes.push_back(DELTA);
+        addVarint(_bytes, keys.size());
+
+        previous = 0;
+        for(Keys::const_iterator key = keys.begin(); keys.end() != key; ++key)
+        {
+            addVarint(_bytes, zigzag(*key, previous));
+            previous = *key;
+        }
+
+        return;
+    }
+
+    _bytes.push_back(BITMAP);
+    addVarint(_bytes, first);
+
+    const size_t bitmap = _bytes.size();
+    _bytes.resize(bitmap + (keys.back() - first) / 8 + 1, 0);
+    for(Keys::const_iterator key = keys.begin(); keys.end() != key; ++key)
+    {
+        const uint32_t offset = *key - first;
+        _bytes[bitmap + offset / 8] |= static_cast<char>(1 << (offset % 8));
+    }
+}
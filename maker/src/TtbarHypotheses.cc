@@ -0,0 +1,276 @@
+// Semileptonic ttbar reconstruction hypotheses
+//
+// Created by Samvel Khalatyan, Mar 19, 2012
+// Copyright 2012, All rights reserved
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "FWCore/ParameterSet/interface/ParameterSet.h"
+#include "FWCore/Utilities/interface/Exception.h"
+
+#include "bsm_input_maker/maker/interface/TtbarHypotheses.h"
+
+using namespace std;
+
+using bsm::TtbarHypotheses;
+using edm::ParameterSet;
+
+namespace
+{
+    // Jet indices are stored in bytes; scratch arrays are on the stack
+    //
+    const uint32_t MAX_JETS = 16;
+    const uint32_t MAX_PAIRS = MAX_JETS * (MAX_JETS - 1) / 2;
+
+    typedef TtbarHypotheses::LorentzVector LorentzVector;
+
+    struct Pair
+    {
+        uint8_t first;
+        uint8_t second;
+
+        double chi2;
+        LorentzVector p4;
+    };
+}
+
+TtbarHypotheses::TtbarHypotheses(const ParameterSet &config):
+    _max_jets(min(config.getParameter<uint32_t>("max_jets"), MAX_JETS)),
+    _max_hypotheses(config.getParameter<uint32_t>("max_hypotheses")),
+    _btag(config.getParameter<string>("btag")),
+    _btag_cut(config.getParameter<double>("btag_cut")),
+    _w_mass(config.getParameter<double>("w_mass")),
+    _w_sigma(config.getParameter<double>("w_sigma")),
+    _top_mass(config.getParameter<double>("top_mass")),
+    _top_sigma(config.getParameter<double>("top_sigma")),
+    _max_pull(config.getParameter<double>("max_pull"))
+{
+    if (0 >= _w_sigma
+            || 0 >= _top_sigma
+            || 0 >= _max_pull)
+        throw cms::Exception("TtbarHypotheses")
+            << "mass resolutions and pull limit should be positive";
+
+    if (!_max_hypotheses)
+        throw cms::Exception("TtbarHypotheses")
+            << "at least one hypothesis should be kept";
+}
+
+const string &TtbarHypotheses::btag() const
+{
+    return _btag;
+}
+
+void TtbarHypotheses::reconstruct(const LorentzVector &lepton,
+        const double &met_px,
+        const double &met_py,
+        const LorentzVectors &jets,
+        const Floats &btags,
+        Hypotheses &hypotheses) const
+{
+    hypotheses.clear();
+
+    const uint32_t jets_size = min<size_t>(jets.size(), _max_jets);
+    if (4 > jets_size)
+        return;
+
+    LorentzVector neutrinos[2];
+    const int neutrino_solutions = neutrino(lepton, met_px, met_py, neutrinos);
+
+    LorentzVector leptonic_w[2];
+    for(int solution = 0; neutrino_solutions > solution; ++solution)
+        leptonic_w[solution] = lepton + neutrinos[solution];
+
+    // B positions are taken by tagged jets if there are at least two, in
+    // the discriminator order: good hypotheses come first and tighten the
+    // chi2 bound
+    //
+    uint8_t b_jets[MAX_JETS];
+    uint32_t b_jets_size = 0;
+    for(uint32_t jet = 0; jets_size > jet; ++jet)
+    {
+        if (_btag_cut <= btags[jet])
+            b_jets[b_jets_size++] = jet;
+    }
+
+    if (2 > b_jets_size)
+    {
+        b_jets_size = 0;
+        for(uint32_t jet = 0; jets_size > jet; ++jet)
+            b_jets[b_jets_size++] = jet;
+    }
+
+    for(uint32_t i = 1; b_jets_size > i; ++i)
+    {
+        const uint8_t jet = b_jets[i];
+
+        uint32_t j = i;
+        for(; 0 < j && btags[b_jets[j - 1]] < btags[jet]; --j)
+            b_jets[j] = b_jets[j - 1];
+
+        b_jets[j] = jet;
+    }
+
+    // Hadronic W candidates in the mass window
+    //
+    Pair pairs[MAX_PAIRS];
+    uint32_t pairs_size = 0;
+    for(uint32_t first = 0; jets_size > first; ++first)
+    {
+        for(uint32_t second = first + 1; jets_size > second; ++second)
+        {
+            Pair &pair = pairs[pairs_size];
+            pair.p4 = jets[first] + jets[second];
+
+            const double pull = (pair.p4.M() - _w_mass) / _w_sigma;
+            if (_max_pull < fabs(pull))
+                continue;
+
+            pair.first = first;
+            pair.second = second;
+            pair.chi2 = pull * pull;
+
+            ++pairs_size;
+        }
+    }
+
+    const double no_bound = numeric_limits<double>::max();
+
+    Hypothesis hypothesis;
+    for(uint32_t hadronic = 0; b_jets_size > hadronic; ++hadronic)
+    {
+        const uint8_t hadronic_b = b_jets[hadronic];
+
+        for(uint32_t index = 0; pairs_size > index; ++index)
+        {
+            const Pair &pair = pairs[index];
+            if (hadronic_b == pair.first
+                    || hadronic_b == pair.second)
+                continue;
+
+            const double bound = _max_hypotheses > hypotheses.size()
+                ? no_bound
+                : hypotheses.back().chi2;
+
+            if (pair.chi2 >= bound)
+                continue;
+
+            const double hadronic_pull =
+                ((pair.p4 + jets[hadronic_b]).M() - _top_mass) / _top_sigma;
+            if (_max_pull < fabs(hadronic_pull))
+                continue;
+
+            const double hadronic_chi2 = pair.chi2
+                + hadronic_pull * hadronic_pull;
+            if (hadronic_chi2 >= bound)
+                continue;
+
+            for(uint32_t leptonic = 0; b_jets_size > leptonic; ++leptonic)
+            {
+                const uint8_t leptonic_b = b_jets[leptonic];
+                if (hadronic_b == leptonic_b
+                        || pair.first == leptonic_b
+                        || pair.second == leptonic_b)
+                    continue;
+
+                for(int solution = 0; neutrino_solutions > solution; ++solution)
+                {
+                    const double leptonic_pull =
+                        ((leptonic_w[solution] + jets[leptonic_b]).M()
+                            - _top_mass) / _top_sigma;
+                    if (_max_pull < fabs(leptonic_pull))
+                        continue;
+
+                    hypothesis.chi2 = hadronic_chi2
+                        + leptonic_pull * leptonic_pull;
+
+                    if (_max_hypotheses <= hypotheses.size()
+                            && hypothesis.chi2 >= hypotheses.back().chi2)
+                        continue;
+
+                    hypothesis.leptonic_b = leptonic_b;
+                    hypothesis.hadronic_b = hadronic_b;
+                    hypothesis.first_quark = pair.first;
+                    hypothesis.second_quark = pair.second;
+                    hypothesis.neutrino = solution;
+
+                    keep(hypothesis, hypotheses);
+                }
+            }
+        }
+    }
+}
+
+int TtbarHypotheses::neutrino(const LorentzVector &lepton,
+        const double &met_px,
+        const double &met_py,
+        LorentzVector *solutions) const
+{
+    const double met2 = met_px * met_px + met_py * met_py;
+    const double lepton_pt2 = lepton.Perp2();
+    if (!lepton_pt2)
+    {
+        solutions[0] = LorentzVector(met_px, met_py, 0, sqrt(met2));
+
+        return 1;
+    }
+
+    // W mass constraint with massless lepton and neutrino
+    //
+    const double mu = 0.5 * _w_mass * _w_mass
+        + lepton.px() * met_px
+        + lepton.py() * met_py;
+    const double a = mu * lepton.pz() / lepton_pt2;
+    const double b = a * a
+        - (lepton.E() * lepton.E() * met2 - mu * mu) / lepton_pt2;
+
+    if (0 > b)
+    {
+        solutions[0] = LorentzVector(met_px, met_py, a,
+                sqrt(met2 + a * a));
+
+        return 1;
+    }
+
+    const double root = sqrt(b);
+    for(int solution = 0; 2 > solution; ++solution)
+    {
+        const double pz = solution ? a + root : a - root;
+
+        solutions[solution] = LorentzVector(met_px, met_py, pz,
+                sqrt(met2 + pz * pz));
+    }
+
+    return 2;
+}
+
+uint64_t TtbarHypotheses::Hypothesis::pack() const
+{
+    return static_cast<uint64_t>(leptonic_b)
+        | static_cast<uint64_t>(hadronic_b) << 8
+        | static_cast<uint64_t>(first_quark) << 16
+        | static_cast<uint64_t>(second_quark) << 24
+        | static_cast<uint64_t>(neutrino) << 32;
+}
+
+
+
+// Privates
+//
+void TtbarHypotheses::keep(const Hypothesis &hypothesis,
+        Hypotheses &hypotheses) const
+{
+    Hypotheses::iterator position = hypotheses.end();
+    for(; hypotheses.begin() != position
+                && (position - 1)->chi2 > hypothesis.chi2;
+            --position)
+    {
+    }
+
+    hypotheses.insert(position, hypothesis);
+
+    if (_max_hypotheses < hypotheses.size())
+        hypotheses.pop_back();
+}
@@ -3,6 +3,11 @@
 // Created by Samvel Khalatyan, Apr 21, 2011
 // Copyright 2011, All rights reserved
 
+#include <cstring>
+
+#include <google/protobuf/message.h>
+#include <google/protobuf/unknown_field_set.h>
+
 #include "bsm_input_maker/bsm_input/interface/Physics.pb.h"
 
 #include "bsm_input_maker/maker/interface/Utility.h"
@@ -21,3 +26,30 @@ void bsm::utility::set(Vector *bsm_v, const math::XYZPoint *cms_v)
     bsm_v->set_y(cms_v->y());
     bsm_v->set_z(cms_v->z());
 }
+
+void bsm::utility::addVarint(google::protobuf::Message *message,
+        const int &field,
+        const uint64_t &value)
+{
+    message->GetReflection()->MutableUnknownFields(message)->AddVarint(field,
+            value);
+}
+
+void bsm::utility::addString(google::protobuf::Message *message,
+        const int &field,
+        const std::string &value)
+{
+    message->GetReflection()->MutableUnknownFields(message)->AddLengthDelimited(
+            field, value);
+}
+
+void bsm::utility::addFloat(google::protobuf::Message *message,
+        const int &field,
+        const float &value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    message->GetReflection()->MutableUnknownFields(message)->AddFixed32(field,
+            bits);
+}